@@ -0,0 +1,25 @@
+QT += gui # QImage is needed as backend to decode pictures
+
+CONFIG += c++11 console
+CONFIG -= app_bundle
+
+TARGET = IRPVBench
+VERSION = 1.0.0.0
+DEFINES += APP_NAME=\\\"$${TARGET}\\\" \
+           APP_VERSION=\\\"$${VERSION}\\\"
+
+DEFINES += QT_DEPRECATED_WARNINGS
+
+CONFIG(release, debug|release): DEFINES += QT_NO_DEBUG_OUTPUT
+
+SOURCES += \
+        main.cpp
+
+INCLUDEPATH += $${PWD}/../IRPVTest
+
+# Benchmarks are built against the same Vendor's API as IRPVTest (nullImpl by default)
+include($${PWD}/../IRPVTest/Vendor.pri)
+include($${PWD}/../IRPVTest/openmp.pri)
+
+HEADERS += \
+    $${PWD}/../IRPVTest/irpvhelper.h
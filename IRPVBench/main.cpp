@@ -0,0 +1,363 @@
+
+#include <iostream>
+#include <functional>
+#include <random>
+#include <sstream>
+
+#include "irpvhelper.h"
+
+//---------------------------------------------------
+
+struct BenchResult
+{
+    QString name, param;
+    size_t  items;
+    std::vector<double> runs; // ns per run
+};
+
+//---------------------------------------------------
+
+BenchResult measure(const QString &_name, const QString &_param, size_t _items, size_t _repeats, const std::function<void()> &_func,
+                    const std::function<void()> &_setup=std::function<void()>())
+{
+    // _setup is called before each run and is not measured, so the input consumed by _func could be restored
+    BenchResult _result;
+    _result.name = _name;
+    _result.param = _param;
+    _result.items = _items;
+    QElapsedTimer _timer;
+    for(size_t i = 0; i < _repeats; ++i) {
+        if(_setup)
+            _setup();
+        _timer.start();
+        _func();
+        _result.runs.push_back(static_cast<double>(_timer.nsecsElapsed()));
+    }
+    const double _min = *std::min_element(_result.runs.begin(), _result.runs.end());
+    std::cout << "  " << _name << " [" << _param << "]: "
+              << 1e-6 * _min << " ms (min of " << _repeats << ")" << std::endl;
+    return _result;
+}
+
+//---------------------------------------------------
+
+QJsonObject serializeBenchResult(const BenchResult &_result)
+{
+    double _min = _result.runs[0], _max = _result.runs[0], _sum = 0;
+    QJsonArray _runs;
+    for(size_t i = 0; i < _result.runs.size(); ++i) {
+        _min = std::min(_min, _result.runs[i]);
+        _max = std::max(_max, _result.runs[i]);
+        _sum += _result.runs[i];
+        _runs.push_back(QJsonValue(_result.runs[i] * 1e-6));
+    }
+    const double _mean = _sum / _result.runs.size();
+    return QJsonObject({
+                           qMakePair(QLatin1String("Name"), QJsonValue(_result.name)),
+                           qMakePair(QLatin1String("Param"), QJsonValue(_result.param)),
+                           qMakePair(QLatin1String("Items"), QJsonValue(static_cast<qint64>(_result.items))),
+                           qMakePair(QLatin1String("Runs_ms"), QJsonValue(_runs)),
+                           qMakePair(QLatin1String("Min_ms"), QJsonValue(_min * 1e-6)),
+                           qMakePair(QLatin1String("Mean_ms"), QJsonValue(_mean * 1e-6)),
+                           qMakePair(QLatin1String("Max_ms"), QJsonValue(_max * 1e-6)),
+                           qMakePair(QLatin1String("Item_ns"), QJsonValue(_result.items > 0 ? _min / _result.items : 0.0))
+                       });
+}
+
+//---------------------------------------------------
+
+void makeScores(size_t _pairs, size_t _positive, std::vector<double> &_similarity, std::vector<uint8_t> &_issameperson)
+{
+    // Genuine and impostor scores are drawn from two overlapping normal distributions
+    std::mt19937 _gen(_pairs);
+    std::normal_distribution<double> _genuine(0.7, 0.1), _impostor(0.3, 0.1);
+    _similarity.assign(_pairs, 0);
+    _issameperson.assign(_pairs, 0);
+    const size_t _step = std::max<size_t>(1, _pairs / std::max<size_t>(1, _positive));
+    for(size_t i = 0; i < _pairs; ++i) {
+        if(i % _step == 0) {
+            _issameperson[i] = 1;
+            _similarity[i] = _genuine(_gen);
+        } else {
+            _similarity[i] = _impostor(_gen);
+        }
+    }
+}
+
+//---------------------------------------------------
+
+std::vector<ROCPoint> makeROC(size_t _points)
+{
+    std::vector<ROCPoint> _roc(_points, ROCPoint());
+    for(size_t i = 0; i < _points; ++i) {
+        const double _x = static_cast<double>(i) / _points;
+        _roc[i].mFAR = 1.0 - _x;
+        _roc[i].mTAR = 1.0 - _x * _x * _x;
+        _roc[i].similarity = _x;
+    }
+    return _roc;
+}
+
+//---------------------------------------------------
+
+QImage makeImage(int _width, int _height, QImage::Format _format)
+{
+    // Smooth gradients with some noise are closer to photos than plain fill for codecs
+    std::mt19937 _gen(static_cast<unsigned>(_width * _height));
+    std::uniform_int_distribution<int> _noise(0, 31);
+    QImage _qimg(_width, _height, QImage::Format_RGB888);
+    for(int y = 0; y < _height; ++y) {
+        uchar *_line = _qimg.scanLine(y);
+        for(int x = 0; x < _width; ++x) {
+            _line[3*x]     = static_cast<uchar>((x * 223 / _width + _noise(_gen)) & 0xFF);
+            _line[3*x + 1] = static_cast<uchar>((y * 223 / _height + _noise(_gen)) & 0xFF);
+            _line[3*x + 2] = static_cast<uchar>(((x + y) * 111 / (_width + _height) + _noise(_gen)) & 0xFF);
+        }
+    }
+    return _format == QImage::Format_RGB888 ? _qimg : _qimg.convertToFormat(_format);
+}
+
+//---------------------------------------------------
+
+int main(int argc, char *argv[])
+{
+#ifdef Q_OS_WIN
+    setlocale(LC_CTYPE,"Rus");
+#endif
+    // Default input values
+    QDir outdir;
+    outdir.setPath("");
+    size_t repeats = 3, rocpoints = 100, minexp = 6, maxexp = 8, matchpairs = 1000000;
+    bool rewriteoutput = false;
+    // If no args passed, show help
+    if(argc == 1) {
+        std::cout << APP_NAME << " version " << APP_VERSION << std::endl;
+        std::cout << "Options:" << std::endl
+                  << "\t-o[str] - output directory where result will be saved" << std::endl
+                  << "\t-r[int] - how many times each benchmark should be repeated (default: " << repeats << ")" << std::endl
+                  << "\t-p[int] - set how many points for ROC curve should be computed (default: " << rocpoints << ")" << std::endl
+                  << "\t-l[int] - lowest power of 10 for synthetic score vector size (default: " << minexp << ")" << std::endl
+                  << "\t-h[int] - highest power of 10 for synthetic score vector size, up to 9 (default: " << maxexp << ")" << std::endl
+                  << "\t-m[int] - number of pairs for Vendor's matching benchmark (default: " << matchpairs << ")" << std::endl
+                  << "\t-w - force output file to be rewritten if already existed" << std::endl;
+        return 0;
+    }
+    // Let's parse user's command input
+    while((--argc > 0) && (**(++argv) == '-'))
+        switch(*(++(*argv))) {
+            case 'o':
+                    outdir.setPath(QString(++(*argv)));
+                break;
+            case 'r':
+                    repeats = QString(++(*argv)).toUInt();
+                break;
+            case 'p':
+                    rocpoints = QString(++(*argv)).toUInt();
+                break;
+            case 'l':
+                    minexp = QString(++(*argv)).toUInt();
+                break;
+            case 'h':
+                    maxexp = QString(++(*argv)).toUInt();
+                break;
+            case 'm':
+                    matchpairs = QString(++(*argv)).toUInt();
+                break;
+            case 'w':
+                    rewriteoutput = true;
+                break;
+        }
+    if(outdir.absolutePath().isEmpty()) {
+        std::cerr << "Empty output directory path! Abort...";
+        return 2;
+    }
+    if(!outdir.exists()) {
+        outdir.mkpath(outdir.absolutePath());
+        if(!outdir.exists()) {
+            std::cerr << "Can not create output directory in the path you've provided! Abort...";
+            return 4;
+        }
+    }
+    if((repeats == 0) || (rocpoints < 2) || (minexp > maxexp) || (maxexp > 9)) {
+        std::cerr << "Invalid benchmark parameters! Abort...";
+        return 5;
+    }
+    QFile outputfile(outdir.absolutePath().append("/%1_bench.json").arg(VENDOR_API_NAME));
+    if(outputfile.exists() && (rewriteoutput == false)) {
+        std::cerr << "Output file already exists in the target location! Abort...";
+        return 8;
+    } else if(outputfile.open(QFile::WriteOnly) == false) {
+        std::cerr << "Can not open output file for write! Abort...";
+        return 9;
+    }
+
+    QDateTime startdt(QDateTime::currentDateTime());
+    std::vector<BenchResult> results;
+
+    // ROC computation over synthetic score vectors
+    std::cout << std::endl << "ROC computation" << std::endl;
+    for(size_t e = minexp; e <= maxexp; ++e) {
+        const size_t _pairs = static_cast<size_t>(std::pow(10.0, static_cast<double>(e)));
+        const size_t _positive = std::max<size_t>(1, _pairs / 1000);
+        std::vector<double>  _similarity;
+        std::vector<uint8_t> _issameperson;
+        makeScores(_pairs, _positive, _similarity, _issameperson);
+        // Same steps as Stage 5: scores are partitioned by labels and sorted in place, ROC and operating points are read from them
+        std::vector<double>  _partitioned;
+        std::vector<uint8_t> _labels;
+        size_t _genuine = 0;
+        auto _restore = [&]() {
+            _partitioned = _similarity;
+            _labels = _issameperson;
+        };
+        results.push_back(measure("partitionScores", QString("pairs=%1").arg(_pairs), _pairs, repeats, [&]() {
+            _genuine = partitionScores(_partitioned, _labels);
+        }, _restore));
+        std::unique_ptr<ScoreDistribution> _scores;
+        results.push_back(measure("ScoreDistribution", QString("pairs=%1").arg(_pairs), _pairs, repeats, [&]() {
+            _scores.reset(new ScoreDistribution(_partitioned, _genuine));
+        }, [&]() {
+            _scores.reset();
+            _restore();
+            _genuine = partitionScores(_partitioned, _labels);
+        }));
+        std::vector<ROCPoint> _roc;
+        results.push_back(measure("computeROC", QString("pairs=%1 points=%2").arg(_pairs).arg(rocpoints), rocpoints, repeats, [&]() {
+            _roc = computeROC(rocpoints, *_scores, 3);
+        }));
+        results.push_back(measure("computeLogROC", QString("pairs=%1 points=%2").arg(_pairs).arg(rocpoints), rocpoints, repeats, [&]() {
+            _roc = computeLogROC(rocpoints, *_scores, 3);
+        }));
+        volatile double _sink = 0;
+        results.push_back(measure("frrAtFAR", QString("pairs=%1").arg(_pairs), 1, repeats, [&]() {
+            _sink = _scores->frrAtFAR(1e-3);
+        }));
+        results.push_back(measure("eer", QString("pairs=%1").arg(_pairs), 1, repeats, [&]() {
+            _sink = _scores->eer();
+        }));
+        Q_UNUSED(_sink)
+    }
+
+    // Operations over ROC table
+    std::cout << std::endl << "ROC table operations" << std::endl;
+    for(size_t _points = 1000; _points <= 1000000; _points *= 10) {
+        const std::vector<ROCPoint> _roc = makeROC(_points);
+        volatile double _sink = 0;
+        results.push_back(measure("findArea", QString("points=%1").arg(_points), _points, repeats, [&]() {
+            _sink = findArea(_roc);
+        }));
+        results.push_back(measure("serializeROC", QString("points=%1").arg(_points), _points, repeats, [&]() {
+            _sink = serializeROC(_roc).size();
+        }));
+        Q_UNUSED(_sink)
+    }
+
+    // Images loading
+    std::cout << std::endl << "Image loading" << std::endl;
+    QDir tmpdir(QDir::temp().absoluteFilePath(QString("%1_%2").arg(APP_NAME).arg(QDateTime::currentDateTime().toString("yyyyMMddhhmmsszzz"))));
+    tmpdir.mkpath(tmpdir.absolutePath());
+    const QSize imagesizes[] = {QSize(320,240), QSize(1280,720), QSize(4000,3000)};
+    const char *imageformats[] = {"jpg", "png", "bmp"};
+    const QImage::Format targetformats[] = {QImage::Format_RGB888, QImage::Format_Grayscale8};
+    std::vector<IRPV::Image> irpvimages;
+    for(size_t s = 0; s < sizeof(imagesizes)/sizeof(imagesizes[0]); ++s) {
+        const QImage _qimg = makeImage(imagesizes[s].width(), imagesizes[s].height(), QImage::Format_RGB888);
+        for(size_t f = 0; f < sizeof(imageformats)/sizeof(imageformats[0]); ++f) {
+            const QString _filename = tmpdir.absoluteFilePath(QString("%1x%2.%3").arg(imagesizes[s].width()).arg(imagesizes[s].height()).arg(imageformats[f]));
+            if(!_qimg.save(_filename, imageformats[f])) {
+                std::cout << "  Can not save " << _filename << ", skipped" << std::endl;
+                continue;
+            }
+            for(size_t t = 0; t < sizeof(targetformats)/sizeof(targetformats[0]); ++t) {
+                IRPV::Image _irpvimg;
+                std::stringstream _format;
+                _format << targetformats[t];
+                results.push_back(measure("readimage", QString("%1x%2 %3 to %4").arg(imagesizes[s].width()).arg(imagesizes[s].height())
+                                                                               .arg(QString(imageformats[f])).arg(QString::fromStdString(_format.str())),
+                                          1, repeats, [&]() {
+                    _irpvimg = readimage(_filename, targetformats[t]);
+                }));
+                if((f == 0) && (t == 0))
+                    irpvimages.push_back(_irpvimg);
+            }
+            // Preprocessing requested by Vendor's API via getPreferredImageSpec()
+            results.push_back(measure("readimage", QString("%1x%2 %3 to Format_RGB888 fit 640x640").arg(imagesizes[s].width()).arg(imagesizes[s].height())
+                                                                                               .arg(QString(imageformats[f])),
+                                      1, repeats, [&]() {
+                readimage(_filename, QImage::Format_RGB888, false, 640, 640);
+            }));
+        }
+    }
+    tmpdir.removeRecursively();
+
+    // Vendor's API calls and Stage 4 bookkeeping
+    std::cout << std::endl << "Vendor's API (" << VENDOR_API_NAME << ")" << std::endl;
+    std::shared_ptr<IRPV::VerifInterface> recognizer = IRPV::VerifInterface::getImplementation();
+    IRPV::ReturnStatus status = recognizer->initialize("");
+    if(status.code != IRPV::ReturnCode::Success) {
+        std::cout << "Can not initialize Vendor's API! Abort..." << std::endl;
+        return 7;
+    }
+    for(size_t i = 0; i < irpvimages.size(); ++i) {
+        std::vector<uint8_t> _templ;
+        results.push_back(measure("createTemplate", QString("%1x%2").arg(static_cast<int>(irpvimages[i].width)).arg(static_cast<int>(irpvimages[i].height)),
+                                  1, repeats, [&]() {
+            _templ.clear();
+            recognizer->createTemplate(irpvimages[i], IRPV::TemplateRole::Enrollment_11, _templ);
+        }));
+    }
+    if(!irpvimages.empty()) {
+        // Matrix of templates with the same shape as in IRPVTest Stage 4
+        const size_t _etcount = std::max<size_t>(1, static_cast<size_t>(std::sqrt(static_cast<double>(matchpairs))));
+        const size_t _vtcount = std::max<size_t>(1, matchpairs / _etcount);
+        std::vector<BiometricTemplate> _etemplates(_etcount), _vtemplates(_vtcount);
+        for(size_t i = 0; i < _etemplates.size(); ++i) {
+            std::vector<uint8_t> _templ;
+            recognizer->createTemplate(irpvimages[0], IRPV::TemplateRole::Enrollment_11, _templ);
+            _etemplates[i] = BiometricTemplate(i, IRPV::TemplateRole::Enrollment_11, std::move(_templ));
+        }
+        for(size_t i = 0; i < _vtemplates.size(); ++i) {
+            std::vector<uint8_t> _templ;
+            recognizer->createTemplate(irpvimages[0], IRPV::TemplateRole::Verification_11, _templ);
+            _vtemplates[i] = BiometricTemplate(i, IRPV::TemplateRole::Verification_11, std::move(_templ));
+        }
+        const size_t _comparisions = _etemplates.size() * _vtemplates.size();
+        std::vector<double>  _similarities(_comparisions, 0);
+        std::vector<uint8_t> _issameperson(_comparisions, 0);
+        results.push_back(measure("matchTemplates", QString("pairs=%1").arg(_comparisions), _comparisions, repeats, [&]() {
+            for(size_t i = 0; i < _etemplates.size(); ++i)
+                for(size_t j = 0; j < _vtemplates.size(); ++j)
+                    recognizer->matchTemplates(*_vtemplates[j].data, *_etemplates[i].data, _similarities[i*_vtemplates.size() + j]);
+        }));
+        // MatchPipeline is used by IRPVTest Stage 4, templates are copied each run as pipeline releases them
+        std::shared_ptr<IRPV::VerifInterface> _recognizer = recognizer;
+        results.push_back(measure("Stage4", QString("pairs=%1").arg(_comparisions), _comparisions, repeats, [&]() {
+            LatencyProfile _latency(0, 10, _comparisions, 100);
+            ProgressReporter _progress("Pairs", _comparisions, "pairs", 0);
+            MatchPipeline _pipeline(_recognizer, _etemplates, _similarities, _issameperson, _latency, _progress, 1, 0, false);
+            for(size_t j = 0; j < _vtemplates.size(); ++j) {
+                std::vector<uint8_t> _data(*_vtemplates[j].data);
+                _pipeline.push(j, BiometricTemplate(_vtemplates[j].label, _vtemplates[j].role, std::move(_data)));
+            }
+            _pipeline.finish();
+            _latency.finish();
+        }));
+    }
+
+    QDateTime enddt = QDateTime::currentDateTime();
+    QJsonArray benchjsarr;
+    for(size_t i = 0; i < results.size(); ++i)
+        benchjsarr.push_back(serializeBenchResult(results[i]));
+    QJsonObject jsonobj({
+                            qMakePair(QLatin1String("Name"),QString(VENDOR_API_NAME)),
+                            qMakePair(QLatin1String("Version"),QString(APP_VERSION)),
+                            qMakePair(QLatin1String("StartDT"),startdt.toString("dd.MM.yyyy hh:mm:ss")),
+                            qMakePair(QLatin1String("EndDT"),enddt.toString("dd.MM.yyyy hh:mm:ss")),
+                            qMakePair(QLatin1String("Repeats"),QJsonValue(static_cast<qint64>(repeats))),
+                            qMakePair(QLatin1String("Benchmarks"),benchjsarr)
+                        });
+    outputfile.write(QJsonDocument(jsonobj).toJson());
+    outputfile.close();
+    std::cout << std::endl << "Data saved" << std::endl;
+    return 0;
+}
@@ -29,4 +29,6 @@ include($${PWD}/Vendor.pri)
 include($${PWD}/openmp.pri)
 
 HEADERS += \
-    irpvhelper.h
+    irpvhelper.h \
+    irpvcompare.h \
+    irpvdaemon.h
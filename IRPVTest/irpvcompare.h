@@ -0,0 +1,333 @@
+#ifndef IRPVCOMPARE_H
+#define IRPVCOMPARE_H
+
+#include <map>
+
+#include "irpvhelper.h"
+
+//---------------------------------------------------
+
+struct ReportMetrics
+{
+    std::map<QString,double>              values; // timing and memory metrics, key is the path in report
+    std::map<QString,std::vector<double>> series; // latency time series of the sections, key is the top level section
+};
+
+//---------------------------------------------------
+
+bool isTimingMetric(const QString &_key)
+{
+    return _key.endsWith("_ms") || _key.endsWith("_us") || (_key == "Initms");
+}
+
+//---------------------------------------------------
+
+bool isMemoryMetric(const QString &_key)
+{
+    return _key.endsWith("_bytes") || _key.endsWith("_kb");
+}
+
+//---------------------------------------------------
+
+bool isThroughputMetric(const QString &_key)
+{
+    return _key.endsWith("_per_s");
+}
+
+//---------------------------------------------------
+
+bool isSeriesMetric(const QString &_keypath)
+{
+    // Metrics measured by the vendor's calls latency series of the section, other timings (image loading,
+    // waiting, CPU time) are not described by that series, so the test on it says nothing about them
+    const QString _key = _keypath.section('/', -1);
+    return (_key == "Gentime_ms") || (_key == "Matchtime_us") || _keypath.contains("/Latency/Steady/");
+}
+
+//---------------------------------------------------
+
+void collectMetrics(const QJsonObject &_jsonobj, const QString &_path, const QString &_section, ReportMetrics &_metrics)
+{
+    const QStringList _keys = _jsonobj.keys();
+    for(int i = 0; i < _keys.size(); ++i) {
+        const QString &_key = _keys.at(i);
+        const QJsonValue _value = _jsonobj.value(_key);
+        const QString _keypath = _path.isEmpty() ? _key : _path + "/" + _key;
+        if(_value.isObject()) {
+            collectMetrics(_value.toObject(), _keypath, _section.isEmpty() ? _key : _section, _metrics);
+        } else if(_value.isDouble()) {
+            if(_key.startsWith("Threshold_")) // SLA thresholds are settings, not measurements
+                continue;
+            if(isTimingMetric(_key) || isMemoryMetric(_key) || isThroughputMetric(_key))
+                _metrics.values[_keypath] = _value.toDouble();
+        } else if(_value.isArray() && _key.startsWith("Series_") && !_section.isEmpty()) {
+            const QJsonArray _jsonarr = _value.toArray();
+            std::vector<double> &_series = _metrics.series[_section];
+            for(int j = 0; j < _jsonarr.size(); ++j)
+                _series.push_back(_jsonarr.at(j).toDouble());
+        }
+    }
+}
+
+//---------------------------------------------------
+
+bool readReport(const QString &_filename, ReportMetrics &_metrics)
+{
+    QFile _file(_filename);
+    if(!_file.open(QFile::ReadOnly))
+        return false;
+    QJsonParseError _error;
+    const QJsonDocument _jsondoc = QJsonDocument::fromJson(_file.readAll(), &_error);
+    if((_error.error != QJsonParseError::NoError) || !_jsondoc.isObject())
+        return false;
+    collectMetrics(_jsondoc.object(), QString(), QString(), _metrics);
+    return true;
+}
+
+//---------------------------------------------------
+
+double mannWhitneyPValue(const std::vector<double> &_a, const std::vector<double> &_b)
+{
+    // Two-sided Mann-Whitney U test with normal approximation and ties correction,
+    // note that reports store latency series as bucket means, so samples are buckets and not single calls
+    const size_t _n1 = _a.size(), _n2 = _b.size(), _n = _n1 + _n2;
+    if((_n1 < 2) || (_n2 < 2))
+        return 1.0;
+    std::vector<std::pair<double,uint8_t>> _all;
+    _all.reserve(_n);
+    for(size_t i = 0; i < _n1; ++i)
+        _all.push_back(std::make_pair(_a[i], static_cast<uint8_t>(0)));
+    for(size_t i = 0; i < _n2; ++i)
+        _all.push_back(std::make_pair(_b[i], static_cast<uint8_t>(1)));
+    std::sort(_all.begin(), _all.end());
+    double _ranksum = 0, _tiesum = 0;
+    for(size_t i = 0; i < _n; ) {
+        size_t j = i;
+        while((j < _n) && (_all[j].first == _all[i].first))
+            ++j;
+        const double _rank = 0.5 * (i + 1 + j); // average rank of the tied group
+        for(size_t k = i; k < j; ++k)
+            if(_all[k].second == 0)
+                _ranksum += _rank;
+        const double _t = static_cast<double>(j - i);
+        _tiesum += _t * _t * _t - _t;
+        i = j;
+    }
+    const double _u = _ranksum - 0.5 * _n1 * (_n1 + 1);
+    const double _mu = 0.5 * _n1 * _n2;
+    const double _sigma = std::sqrt((static_cast<double>(_n1) * _n2 / 12.0) * ((_n + 1) - _tiesum / (static_cast<double>(_n) * (_n - 1))));
+    if(_sigma <= 0)
+        return 1.0;
+    const double _z = (_u - _mu) / _sigma;
+    return std::erfc(std::fabs(_z) / std::sqrt(2.0));
+}
+
+//---------------------------------------------------
+
+bool measureNoise(const QString &_sampledir, const QString &_resources, size_t _samples, size_t _repeats, double &_gennoise, double &_matchnoise)
+{
+    // Reruns fixed micro-sample several times, noise is estimated as 2 coefficients of variation of the mean call time in percents
+    const QStringList _filefilters = imageFileFilters();
+    QDir _dir(_sampledir);
+    QStringList _files = _dir.entryList(_filefilters, QDir::Files | QDir::NoDotAndDotDot, QDir::Name);
+    for(int i = 0; i < _files.size(); ++i)
+        _files[i] = _dir.absoluteFilePath(_files.at(i));
+    const QStringList _subdirs = _dir.entryList(QDir::Dirs | QDir::NoDotAndDotDot, QDir::Name);
+    for(int i = 0; (i < _subdirs.size()) && (static_cast<size_t>(_files.size()) < _samples); ++i) {
+        QDir _subdir(_dir.absoluteFilePath(_subdirs.at(i)));
+        const QStringList _subfiles = _subdir.entryList(_filefilters, QDir::Files | QDir::NoDotAndDotDot, QDir::Name);
+        for(int j = 0; j < _subfiles.size(); ++j)
+            _files.append(_subdir.absoluteFilePath(_subfiles.at(j)));
+    }
+    _files = _files.mid(0, static_cast<int>(_samples));
+    if(_files.isEmpty() || (_repeats < 2))
+        return false;
+
+    std::shared_ptr<IRPV::VerifInterface> _recognizer = IRPV::VerifInterface::getImplementation();
+    if(_recognizer->initialize(_resources.toStdString()).code != IRPV::ReturnCode::Success)
+        return false;
+    IRPV::ImageSpec _spec;
+    getPreferredImageSpec(_recognizer, _spec);
+    std::vector<IRPV::Image> _images;
+    for(int i = 0; i < _files.size(); ++i)
+        _images.push_back(readimage(_files.at(i), _spec.depth == 8 ? QImage::Format_Grayscale8 : QImage::Format_RGB888, false, _spec.maxwidth, _spec.maxheight));
+
+    QElapsedTimer _timer;
+    std::vector<double> _gentimes, _matchtimes;
+    for(size_t r = 0; r < _repeats; ++r) {
+        std::vector<std::vector<uint8_t>> _templates(_images.size());
+        _timer.start();
+        for(size_t i = 0; i < _images.size(); ++i)
+            _recognizer->createTemplate(_images[i], IRPV::TemplateRole::Enrollment_11, _templates[i]);
+        _gentimes.push_back(static_cast<double>(_timer.nsecsElapsed()) / _images.size());
+        double _similarity;
+        _timer.start();
+        for(size_t i = 0; i < _templates.size(); ++i)
+            for(size_t j = 0; j < _templates.size(); ++j)
+                _recognizer->matchTemplates(_templates[j], _templates[i], _similarity);
+        _matchtimes.push_back(static_cast<double>(_timer.nsecsElapsed()) / (_templates.size() * _templates.size()));
+    }
+    auto _cv = [](const std::vector<double> &_v) {
+        double _mean = 0, _var = 0;
+        for(size_t i = 0; i < _v.size(); ++i)
+            _mean += _v[i];
+        _mean /= _v.size();
+        for(size_t i = 0; i < _v.size(); ++i)
+            _var += (_v[i] - _mean) * (_v[i] - _mean);
+        _var /= (_v.size() - 1);
+        return _mean > 0 ? std::sqrt(_var) / _mean : 0.0;
+    };
+    _gennoise = 200.0 * _cv(_gentimes);
+    _matchnoise = 200.0 * _cv(_matchtimes);
+    return true;
+}
+
+//---------------------------------------------------
+
+int compareReports(int argc, char *argv[])
+{
+    // Default input values
+    double thresholdpercent = 5, alpha = 0.05;
+    QString sampledir, apiresourcespath, outputfilename;
+    size_t samples = 10, repeats = 0;
+    QStringList reports;
+    if(argc == 0) {
+        std::cout << APP_NAME << " compare [options] baseline.json candidate.json [candidate2.json ...]" << std::endl;
+        std::cout << "Options:" << std::endl
+                  << "\t-t[real] - regression threshold for timing and memory metrics in percents (default: " << thresholdpercent << ")" << std::endl
+                  << "\t-p[real] - significance level for the test on latency series bucket means, applied to vendor's call times only (default: " << alpha << ")" << std::endl
+                  << "\t-i[str] - directory with micro-sample images to estimate run-to-run noise of Vendor's API linked" << std::endl
+                  << "\t-n[int] - number of micro-sample images (default: " << samples << ")" << std::endl
+                  << "\t-k[int] - how many times micro-sample should be rerun, at least 2 (default: noise is not estimated)" << std::endl
+                  << "\t-r[str] - path where Vendor's API should search resources" << std::endl
+                  << "\t-o[str] - file where comparison will be saved in json" << std::endl;
+        return 0;
+    }
+    for(int i = 0; i < argc; ++i) {
+        char *_arg = argv[i];
+        if(*_arg != '-') {
+            reports.append(QString::fromLocal8Bit(_arg));
+            continue;
+        }
+        switch(*(++_arg)) {
+            case 't':
+                    thresholdpercent = QString(++_arg).toDouble();
+                break;
+            case 'p':
+                    alpha = QString(++_arg).toDouble();
+                break;
+            case 'i':
+                    sampledir = QString(++_arg);
+                break;
+            case 'n':
+                    samples = QString(++_arg).toUInt();
+                break;
+            case 'k':
+                    repeats = QString(++_arg).toUInt();
+                break;
+            case 'r':
+                    apiresourcespath = QString(++_arg);
+                break;
+            case 'o':
+                    outputfilename = QString(++_arg);
+                break;
+        }
+    }
+    if(reports.size() < 2) {
+        std::cerr << "At least two reports should be provided! Abort...";
+        return 13;
+    }
+    std::vector<ReportMetrics> metrics(static_cast<size_t>(reports.size()));
+    for(int i = 0; i < reports.size(); ++i) {
+        if(!readReport(reports.at(i), metrics[static_cast<size_t>(i)])) {
+            std::cerr << "Can not read report " << reports.at(i) << "! Abort...";
+            return 13;
+        }
+    }
+
+    // Deltas smaller than run-to-run noise of the micro-sample are not counted as regressions
+    double gennoise = 0, matchnoise = 0;
+    if(!sampledir.isEmpty() && (repeats > 0)) {
+        std::cout << "Micro-sample noise estimation (" << VENDOR_API_NAME << ")" << std::endl;
+        if(!measureNoise(sampledir, apiresourcespath, samples, repeats, gennoise, matchnoise)) {
+            std::cerr << "Can not run micro-sample! Abort...";
+            return 13;
+        }
+        std::cout << "  createTemplate noise: " << QString::number(gennoise,'f',2) << " %" << std::endl
+                  << "  matchTemplates noise: " << QString::number(matchnoise,'f',2) << " %" << std::endl;
+    }
+    const double timingthreshold = std::max(thresholdpercent, std::max(gennoise, matchnoise));
+
+    size_t regressions = 0;
+    QJsonArray candidatesjsarr;
+    const ReportMetrics &baseline = metrics[0];
+    for(size_t c = 1; c < metrics.size(); ++c) {
+        std::cout << std::endl << reports.at(static_cast<int>(c)) << " vs " << reports.at(0) << std::endl;
+        QJsonArray _deltasjsarr;
+        for(std::map<QString,double>::const_iterator it = baseline.values.begin(); it != baseline.values.end(); ++it) {
+            std::map<QString,double>::const_iterator _candidate = metrics[c].values.find(it->first);
+            if(_candidate == metrics[c].values.end())
+                continue;
+            const QString _key = it->first.section('/', -1);
+            const bool _timing = isTimingMetric(_key) || isThroughputMetric(_key);
+            // For throughput higher is better, so the sign is inverted to count slowdowns as positive delta
+            double _delta = (it->second != 0) ? 100.0 * (_candidate->second - it->second) / std::fabs(it->second) : 0.0;
+            if(isThroughputMetric(_key))
+                _delta = -_delta;
+            double _pvalue = -1; // -1 means there is no series to test
+            const QString _section = it->first.section('/', 0, 0);
+            std::map<QString,std::vector<double>>::const_iterator _baseseries = baseline.series.find(_section);
+            std::map<QString,std::vector<double>>::const_iterator _candseries = metrics[c].series.find(_section);
+            if(isSeriesMetric(it->first) && (_baseseries != baseline.series.end()) && (_candseries != metrics[c].series.end()))
+                _pvalue = mannWhitneyPValue(_baseseries->second, _candseries->second);
+            const double _threshold = _timing ? timingthreshold : thresholdpercent;
+            const bool _regression = (_delta > _threshold) && ((_pvalue < 0) || (_pvalue < alpha));
+            if(_regression)
+                regressions++;
+            std::cout << "  " << it->first << ": " << it->second << " -> " << _candidate->second
+                      << " (" << (_delta > 0 ? "+" : "") << QString::number(_delta,'f',2) << " %";
+            if(_pvalue >= 0)
+                std::cout << ", p=" << QString::number(_pvalue,'g',3);
+            std::cout << ")" << (_regression ? " REGRESSION" : "") << std::endl;
+            QJsonObject _deltajsobj({
+                                        qMakePair(QLatin1String("Metric"), QJsonValue(it->first)),
+                                        qMakePair(QLatin1String("Baseline"), QJsonValue(it->second)),
+                                        qMakePair(QLatin1String("Candidate"), QJsonValue(_candidate->second)),
+                                        qMakePair(QLatin1String("Delta_percent"), QJsonValue(_delta)),
+                                        qMakePair(QLatin1String("Regression"), QJsonValue(_regression))
+                                    });
+            if(_pvalue >= 0)
+                _deltajsobj.insert(QLatin1String("Pvalue"), QJsonValue(_pvalue));
+            _deltasjsarr.push_back(qMove(_deltajsobj));
+        }
+        QJsonObject _candidatejsobj({
+                                        qMakePair(QLatin1String("Report"), QJsonValue(reports.at(static_cast<int>(c)))),
+                                        qMakePair(QLatin1String("Deltas"), QJsonValue(_deltasjsarr))
+                                    });
+        candidatesjsarr.push_back(qMove(_candidatejsobj));
+    }
+    std::cout << std::endl << "Regressions: " << regressions << std::endl;
+
+    if(!outputfilename.isEmpty()) {
+        QFile _outputfile(outputfilename);
+        if(!_outputfile.open(QFile::WriteOnly)) {
+            std::cerr << "Can not open output file for write! Abort...";
+            return 9;
+        }
+        QJsonObject _jsonobj({
+                                 qMakePair(QLatin1String("Baseline"), QJsonValue(reports.at(0))),
+                                 qMakePair(QLatin1String("Threshold_percent"), QJsonValue(thresholdpercent)),
+                                 qMakePair(QLatin1String("Timingthreshold_percent"), QJsonValue(timingthreshold)),
+                                 qMakePair(QLatin1String("Alpha"), QJsonValue(alpha)),
+                                 qMakePair(QLatin1String("Gennoise_percent"), QJsonValue(gennoise)),
+                                 qMakePair(QLatin1String("Matchnoise_percent"), QJsonValue(matchnoise)),
+                                 qMakePair(QLatin1String("Regressions"), QJsonValue(static_cast<qint64>(regressions))),
+                                 qMakePair(QLatin1String("Candidates"), QJsonValue(candidatesjsarr))
+                             });
+        _outputfile.write(QJsonDocument(_jsonobj).toJson());
+        _outputfile.close();
+    }
+    return regressions > 0 ? 12 : 0;
+}
+
+#endif // IRPVCOMPARE_H
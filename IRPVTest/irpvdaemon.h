@@ -0,0 +1,569 @@
+#ifndef IRPVDAEMON_H
+#define IRPVDAEMON_H
+
+#include <list>
+
+#include "irpvhelper.h"
+
+#ifdef Q_OS_LINUX
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/stat.h>
+#include <sys/time.h>
+#endif
+
+//---------------------------------------------------
+
+template<typename T>
+class LRUCache
+{
+public:
+    // Least recently used entries are evicted when total size of the entries exceeds _capacitybytes
+    explicit LRUCache(size_t _capacitybytes) :
+        capacity(_capacitybytes),
+        bytes(0),
+        hits(0),
+        misses(0) {}
+
+    bool get(const QString &_key, T &_value)
+    {
+        typename QHash<QString,typename std::list<Entry>::iterator>::iterator _it = index.find(_key);
+        if(_it == index.end()) {
+            misses++;
+            return false;
+        }
+        entries.splice(entries.begin(), entries, _it.value()); // move to the front, iterators stay valid
+        _value = entries.front().value;
+        hits++;
+        return true;
+    }
+
+    void put(const QString &_key, const T &_value, size_t _bytes)
+    {
+        if(_bytes > capacity)
+            return;
+        typename QHash<QString,typename std::list<Entry>::iterator>::iterator _it = index.find(_key);
+        if(_it != index.end()) {
+            bytes -= _it.value()->bytes;
+            entries.erase(_it.value());
+            index.erase(_it);
+        }
+        while(!entries.empty() && (bytes + _bytes > capacity)) {
+            bytes -= entries.back().bytes;
+            index.remove(entries.back().key);
+            entries.pop_back();
+        }
+        entries.push_front(Entry(_key, _value, _bytes));
+        index.insert(_key, entries.begin());
+        bytes += _bytes;
+    }
+
+    size_t size() const { return entries.size(); }
+
+    size_t capacity;
+    size_t bytes;
+    size_t hits, misses;
+
+private:
+    struct Entry
+    {
+        Entry(const QString &_key, const T &_value, size_t _bytes) :
+            key(_key),
+            value(_value),
+            bytes(_bytes) {}
+
+        QString key;
+        T       value;
+        size_t  bytes;
+    };
+
+    std::list<Entry> entries; // most recently used first
+    QHash<QString,typename std::list<Entry>::iterator> index;
+};
+
+//---------------------------------------------------
+
+struct DaemonCaches
+{
+    DaemonCaches(size_t _imagebytes, size_t _templatebytes) :
+        images(_imagebytes),
+        templates(_templatebytes) {}
+
+    LRUCache<IRPV::Image>          images;    // decoded and downscaled images
+    LRUCache<std::vector<uint8_t>> templates; // successfully created templates, key includes template role
+};
+
+//---------------------------------------------------
+
+QString cacheKey(const QString &_filename)
+{
+    // Modification time is a part of the key, so changed files are never served from the cache
+    const QFileInfo _fileinfo(_filename);
+    return QString("%1|%2|%3").arg(_fileinfo.absoluteFilePath()).arg(_fileinfo.lastModified().toMSecsSinceEpoch()).arg(_fileinfo.size());
+}
+
+//---------------------------------------------------
+
+bool collectDirectoryJob(const QDir &_indir, size_t _etpp, size_t _vtpp, QStringList &_enrollfiles, QStringList &_verifyfiles,
+                         std::vector<TemplatePair> &_pairs)
+{
+    // Same selection as in the test mode: first etpp files of the valid subdir are enrollment ones, next vtpp are
+    // verification ones and all files in the root of the input directory are distractors, every pair is matched
+    const QStringList _filefilters = imageFileFilters();
+    const size_t _minfilespp = (_vtpp == 0 ? _etpp : _etpp + _vtpp);
+    std::vector<size_t> _elabels, _vlabels;
+    size_t _label = 0;
+    const QStringList _subdirs = _indir.entryList(QDir::Dirs | QDir::NoDotAndDotDot, QDir::Name);
+    for(int i = 0; i < _subdirs.size(); ++i) {
+        QDir _subdir(_indir.absoluteFilePath(_subdirs.at(i)));
+        const QStringList _files = _subdir.entryList(_filefilters, QDir::Files | QDir::NoDotAndDotDot, QDir::Name);
+        if(static_cast<size_t>(_files.size()) < _minfilespp)
+            continue;
+        for(size_t j = 0; j < _minfilespp; ++j) {
+            if(j < _etpp) {
+                _enrollfiles.append(_subdir.absoluteFilePath(_files.at(static_cast<int>(j))));
+                _elabels.push_back(_label);
+            } else {
+                _verifyfiles.append(_subdir.absoluteFilePath(_files.at(static_cast<int>(j))));
+                _vlabels.push_back(_label);
+            }
+        }
+        _label++;
+    }
+    const QStringList _distractors = _indir.entryList(_filefilters, QDir::Files | QDir::NoDotAndDotDot, QDir::Name);
+    for(int i = 0; i < _distractors.size(); ++i) {
+        _verifyfiles.append(_indir.absoluteFilePath(_distractors.at(i)));
+        _vlabels.push_back(_label++);
+    }
+    if(_enrollfiles.isEmpty() || _verifyfiles.isEmpty())
+        return false;
+    _pairs.reserve(_elabels.size() * _vlabels.size());
+    for(size_t i = 0; i < _elabels.size(); ++i)
+        for(size_t j = 0; j < _vlabels.size(); ++j)
+            _pairs.push_back(TemplatePair(i, j, _elabels[i] == _vlabels[j] ? 1 : 0));
+    return true;
+}
+
+//---------------------------------------------------
+
+bool readJobNumber(const QJsonObject &_request, const QString &_key, double _default, double _min, double _max, bool _integral,
+                   double &_value, QString &_error)
+{
+    // Job options come from the client, so they are checked before any of them reaches allocations or thread counts
+    const QJsonValue _jsonvalue = _request.value(_key);
+    if(_jsonvalue.isUndefined()) {
+        _value = _default;
+        return true;
+    }
+    _value = _jsonvalue.toDouble(std::numeric_limits<double>::quiet_NaN());
+    if(!_jsonvalue.isDouble() || !((_value >= _min) && (_value <= _max)) || (_integral && (_value != std::floor(_value)))) {
+        _error = QString("%1 should be %2 in [%3, %4]").arg(_key).arg(_integral ? QString("an integer") : QString("a number")).arg(_min).arg(_max);
+        return false;
+    }
+    return true;
+}
+
+//---------------------------------------------------
+
+QJsonObject serveJob(const std::shared_ptr<IRPV::VerifInterface> &_recognizer, const IRPV::ImageSpec &_spec, QImage::Format _format,
+                     DaemonCaches &_caches, const QJsonObject &_request, const std::function<void(const QJsonObject&)> &_send)
+{
+    // Job is either a directory with irpv-compliant structure or a pair list, directory jobs are
+    // converted to the pair list of all enrollment and verification templates, so both are served the same way
+    const QDir _indir(_request.value("Input").toString());
+    const QString _pairlist = _request.value("Pairlist").toString();
+    double _etppvalue, _vtppvalue, _rocpointsvalue, _confexamplesvalue, _workersvalue, _matchdeadlinems;
+    QString _optionerror;
+    if(!readJobNumber(_request, "Enrollment", 1, 1, 1000, true, _etppvalue, _optionerror) ||
+       !readJobNumber(_request, "Verification", 1, 0, 1000, true, _vtppvalue, _optionerror) ||
+       !readJobNumber(_request, "Rocpoints", 10000, 2, 1e7, true, _rocpointsvalue, _optionerror) ||
+       !readJobNumber(_request, "Confexamples", 3, 1, 1e6, true, _confexamplesvalue, _optionerror) ||
+       !readJobNumber(_request, "Workers", 1, 1, std::max(1u, std::thread::hardware_concurrency()), true, _workersvalue, _optionerror) ||
+       !readJobNumber(_request, "Matchdeadline_ms", 0, 0, 3.6e6, false, _matchdeadlinems, _optionerror))
+        return QJsonObject({qMakePair(QLatin1String("Error"),QJsonValue(_optionerror))});
+    const size_t _etpp = static_cast<size_t>(_etppvalue);
+    const size_t _vtpp = static_cast<size_t>(_vtppvalue);
+    const size_t _rocpoints = static_cast<size_t>(_rocpointsvalue);
+    const uint _confexamples = static_cast<uint>(_confexamplesvalue);
+    const size_t _workers = static_cast<size_t>(_workersvalue);
+    QStringList _enrollfiles, _verifyfiles;
+    std::vector<TemplatePair> _pairs;
+    if(!_pairlist.isEmpty()) {
+        QString _error;
+        if(!readPairList(_pairlist, _indir, _enrollfiles, _verifyfiles, _pairs, _error))
+            return QJsonObject({qMakePair(QLatin1String("Error"),QJsonValue(_error))});
+    } else if(!_indir.exists() || !collectDirectoryJob(_indir, _etpp, _vtpp, _enrollfiles, _verifyfiles, _pairs)) {
+        return QJsonObject({qMakePair(QLatin1String("Error"),QJsonValue(QString("Input directory has no valid templates")))});
+    }
+    if(_pairs.empty())
+        return QJsonObject({qMakePair(QLatin1String("Error"),QJsonValue(QString("There is 0 pairs")))});
+    _send(QJsonObject({
+                          qMakePair(QLatin1String("Event"),QJsonValue(QString("Templates"))),
+                          qMakePair(QLatin1String("Enrollment"),QJsonValue(_enrollfiles.size())),
+                          qMakePair(QLatin1String("Verification"),QJsonValue(_verifyfiles.size()))
+                      }));
+
+    // Templates are taken from the cache if possible, otherwise decoded images are
+    size_t _generrors = 0, _templatehits = 0, _imagehits = 0, _created = 0;
+    double _gentime = 0, _loadtime = 0;
+    QElapsedTimer _timer;
+    auto _create = [&](const QStringList &_files, IRPV::TemplateRole _role, std::vector<BiometricTemplate> &_templates) {
+        _templates.resize(static_cast<size_t>(_files.size()));
+        for(int i = 0; i < _files.size(); ++i) {
+            const QString _imagekey = cacheKey(_files.at(i));
+            const QString _templatekey = QString("%1|%2").arg(_imagekey).arg(static_cast<int>(_role));
+            std::vector<uint8_t> _templ;
+            if(_caches.templates.get(_templatekey, _templ)) {
+                _templatehits++;
+            } else {
+                IRPV::Image _irpvimg;
+                if(_caches.images.get(_imagekey, _irpvimg)) {
+                    _imagehits++;
+                } else {
+                    _timer.start();
+                    _irpvimg = readimage(_files.at(i), _format, false, _spec.maxwidth, _spec.maxheight);
+                    _loadtime += _timer.nsecsElapsed();
+                    if(_irpvimg.data)
+                        _caches.images.put(_imagekey, _irpvimg, _irpvimg.size());
+                }
+                _timer.start();
+                const IRPV::ReturnStatus _status = _recognizer->createTemplate(_irpvimg, _role, _templ);
+                _gentime += _timer.nsecsElapsed();
+                _created++;
+                if(_status.code == IRPV::ReturnCode::Success)
+                    _caches.templates.put(_templatekey, _templ, _templ.size());
+                else
+                    _generrors++;
+            }
+            _templates[static_cast<size_t>(i)] = BiometricTemplate(static_cast<size_t>(i), _role, std::move(_templ));
+        }
+    };
+    std::vector<BiometricTemplate> _etemplates, _vtemplates;
+    _create(_enrollfiles, IRPV::TemplateRole::Enrollment_11, _etemplates);
+    _create(_verifyfiles, IRPV::TemplateRole::Verification_11, _vtemplates);
+
+    _send(QJsonObject({
+                          qMakePair(QLatin1String("Event"),QJsonValue(QString("Match"))),
+                          qMakePair(QLatin1String("Pairs"),QJsonValue(static_cast<qint64>(_pairs.size())))
+                      }));
+    std::vector<double>  _similarities(_pairs.size(), 0);
+    std::vector<uint8_t> _issameperson(_pairs.size(), 0);
+    size_t _positive = 0;
+    for(size_t k = 0; k < _pairs.size(); ++k) {
+        _issameperson[k] = _pairs[k].same;
+        _positive += _pairs[k].same;
+    }
+    const size_t _negative = _pairs.size() - _positive;
+    LatencyProfile _latency(0, 10, _pairs.size(), 100, 1e6 * _matchdeadlinems);
+    ProgressReporter _progress("Pairs", _pairs.size(), "pairs", 0);
+    _timer.start();
+    const MatchCounters _counters = matchPairs(_recognizer, _etemplates, _vtemplates, _pairs, _similarities, _latency, _progress,
+                                               _workers, _matchdeadlinems, false);
+    const qint64 _matchwalltime = _timer.nsecsElapsed();
+    _latency.finish();
+    _etemplates.clear();
+    _vtemplates.clear();
+
+    QJsonObject _result({
+                            qMakePair(QLatin1String("Event"),QJsonValue(QString("Result"))),
+                            qMakePair(QLatin1String("Templates"),QJsonObject({
+                                 qMakePair(QLatin1String("Enrollment"),QJsonValue(_enrollfiles.size())),
+                                 qMakePair(QLatin1String("Verification"),QJsonValue(_verifyfiles.size())),
+                                 qMakePair(QLatin1String("Created"),QJsonValue(static_cast<qint64>(_created))),
+                                 qMakePair(QLatin1String("Errors"),QJsonValue(static_cast<qint64>(_generrors))),
+                                 qMakePair(QLatin1String("Cachehits"),QJsonValue(static_cast<qint64>(_templatehits))),
+                                 qMakePair(QLatin1String("Imagecachehits"),QJsonValue(static_cast<qint64>(_imagehits))),
+                                 qMakePair(QLatin1String("Gentime_ms"),QJsonValue(1e-6 * _gentime / std::max<size_t>(1, _created))),
+                                 qMakePair(QLatin1String("Loadtime_ms"),QJsonValue(1e-6 * _loadtime / std::max<size_t>(1, _created - _imagehits)))
+                             })),
+                            qMakePair(QLatin1String("Match"),QJsonObject({
+                                 qMakePair(QLatin1String("Positivepairs"),QJsonValue(static_cast<qint64>(_positive))),
+                                 qMakePair(QLatin1String("Negativepairs"),QJsonValue(static_cast<qint64>(_negative))),
+                                 qMakePair(QLatin1String("Errors"),QJsonValue(static_cast<qint64>(_counters.errors))),
+                                 qMakePair(QLatin1String("Timeouts"),QJsonValue(static_cast<qint64>(_counters.timeouts))),
+                                 qMakePair(QLatin1String("Matchtime_us"),QJsonValue(1e-3 * _counters.matchtime / std::max<size_t>(1, _pairs.size() - _counters.skipped))),
+                                 qMakePair(QLatin1String("Pairs_per_s"),QJsonValue(1e9 * (_pairs.size() - _counters.skipped) / std::max<qint64>(1, _matchwalltime))),
+                                 qMakePair(QLatin1String("Latency"),serializeLatency(_latency, 1e-3, "us"))
+                             }))
+                        });
+    // ROC could be computed only if both positive and negative pairs exist
+    if((_positive > _confexamples) && (_negative > _confexamples)) {
+        const size_t _genuine = partitionScores(_similarities, _issameperson);
+        _issameperson.clear(); _issameperson.shrink_to_fit();
+        const ScoreDistribution _scores(_similarities, _genuine);
+        const std::vector<ROCPoint> _roc = _request.value("Logroc").toBool(false) ? computeLogROC(_rocpoints, _scores, _confexamples)
+                                                                                  : computeROC(_rocpoints, _scores, _confexamples);
+        const double _bestFAR = std::exp(std::log(10.0) * -validdigits(_negative, _confexamples));
+        _result.insert(QLatin1String("ROCarea"), QJsonValue(findArea(_roc)));
+        _result.insert(QLatin1String("FAR"), QJsonValue(_bestFAR));
+        _result.insert(QLatin1String("FRR"), QJsonValue(std::max(static_cast<double>(_confexamples) / _positive, _scores.frrAtFAR(_bestFAR))));
+        _result.insert(QLatin1String("EER"), QJsonValue(_scores.eer()));
+        if(_request.value("ROC").toBool(false))
+            _result.insert(QLatin1String("ROC"), serializeROC(_roc));
+    }
+    return _result;
+}
+
+//---------------------------------------------------
+
+#ifdef Q_OS_LINUX
+bool sendLine(int _socket, const QJsonObject &_jsonobj)
+{
+    // One JSON object per line, MSG_NOSIGNAL prevents SIGPIPE if client has gone away
+    QByteArray _line = QJsonDocument(_jsonobj).toJson(QJsonDocument::Compact);
+    _line.append('\n');
+    const char *_data = _line.constData();
+    size_t _left = static_cast<size_t>(_line.size());
+    while(_left > 0) {
+        const ssize_t _sent = ::send(_socket, _data, _left, MSG_NOSIGNAL);
+        if(_sent <= 0)
+            return false;
+        _data += _sent;
+        _left -= static_cast<size_t>(_sent);
+    }
+    return true;
+}
+
+//---------------------------------------------------
+
+bool readLine(int _socket, QByteArray &_line, qint64 _deadlinems)
+{
+    // Returns false if the line is not complete before deadline, deadline limits the whole line and not each receive,
+    // so client sending byte by byte can not hold the daemon. Only one line per connection is read, so tail is dropped
+    QElapsedTimer _timer;
+    _timer.start();
+    char _buffer[4096];
+    for(;;) {
+        const qint64 _leftms = _deadlinems - _timer.elapsed();
+        if(_leftms <= 0)
+            return false;
+        struct timeval _timeout;
+        _timeout.tv_sec = static_cast<time_t>(_leftms / 1000);
+        _timeout.tv_usec = static_cast<suseconds_t>((_leftms % 1000) * 1000);
+        ::setsockopt(_socket, SOL_SOCKET, SO_RCVTIMEO, &_timeout, sizeof(_timeout));
+        const ssize_t _received = ::recv(_socket, _buffer, sizeof(_buffer), 0);
+        if(_received <= 0)
+            return (_received == 0) && !_line.isEmpty(); // client has closed its side without new line
+        const char *_end = static_cast<const char*>(std::memchr(_buffer, '\n', static_cast<size_t>(_received)));
+        _line.append(_buffer, static_cast<int>(_end ? _end - _buffer : _received));
+        if(_end)
+            return true;
+        if(_line.size() > 65536)
+            return false;
+    }
+}
+#endif
+
+//---------------------------------------------------
+
+#ifdef Q_OS_LINUX
+bool removeStaleSocket(const char *_path)
+{
+    // Only socket could be removed, so wrong -u path does not delete user's file
+    struct stat _stat;
+    if(::lstat(_path, &_stat) != 0)
+        return true; // nothing to remove
+    if(!S_ISSOCK(_stat.st_mode))
+        return false;
+    return ::unlink(_path) == 0;
+}
+#endif
+
+//---------------------------------------------------
+
+struct DaemonJob
+{
+    int           socket;
+    QJsonObject   request;
+    QElapsedTimer queued; // started when job has been accepted
+    size_t        id;
+};
+
+//---------------------------------------------------
+
+int runDaemon(int argc, char *argv[])
+{
+    // Default input values
+    QString socketpath = QDir::temp().absoluteFilePath(QString("%1.sock").arg(APP_NAME));
+    QString apiresourcespath;
+    size_t imagecachemb = 512, templatecachemb = 256;
+    bool grayscale = false;
+    if((argc > 0) && (QString(argv[0]) == "-h")) {
+        std::cout << APP_NAME << " daemon [options]" << std::endl;
+        std::cout << "Options:" << std::endl
+                  << "\t-u[str] - Unix domain socket path (default: " << socketpath.toStdString() << ")" << std::endl
+                  << "\t-r[str] - path where Vendor's API should search resources" << std::endl
+                  << "\t-m[int] - decoded images cache size in MB (default: " << imagecachemb << ")" << std::endl
+                  << "\t-t[int] - templates cache size in MB (default: " << templatecachemb << ")" << std::endl
+                  << "\t-g - force to open all images in 8-bit grayscale mode if Vendor's API has no preference" << std::endl
+                  << "Protocol:" << std::endl
+                  << "\tclient sends one JSON object per connection terminated by new line, for the instance:" << std::endl
+                  << "\t{\"Input\":\"/data/set\",\"Pairlist\":\"pairs.txt\",\"Enrollment\":1,\"Verification\":1,\"Rocpoints\":10000," << std::endl
+                  << "\t \"Confexamples\":3,\"Workers\":1,\"Matchdeadline_ms\":0,\"ROC\":false,\"Logroc\":false}" << std::endl
+                  << "\tor {\"Command\":\"Shutdown\"}, daemon streams back JSON lines: Queued, Started, Templates, Match and Result" << std::endl;
+        return 0;
+    }
+    for(int i = 0; i < argc; ++i) {
+        char *_arg = argv[i];
+        if(*_arg != '-')
+            continue;
+        switch(*(++_arg)) {
+            case 'u':
+                    socketpath = QString(++_arg);
+                break;
+            case 'r':
+                    apiresourcespath = QString(++_arg);
+                break;
+            case 'm':
+                    imagecachemb = QString(++_arg).toUInt();
+                break;
+            case 't':
+                    templatecachemb = QString(++_arg).toUInt();
+                break;
+            case 'g':
+                    grayscale = true;
+                break;
+        }
+    }
+#ifdef Q_OS_LINUX
+    // Vendor's API is initialized once and serves all jobs
+    std::cout << "Vendor's API loading" << std::endl;
+    std::shared_ptr<IRPV::VerifInterface> recognizer = IRPV::VerifInterface::getImplementation();
+    QElapsedTimer elapsedtimer;
+    elapsedtimer.start();
+    IRPV::ReturnStatus status = recognizer->initialize(apiresourcespath.toStdString());
+    std::cout << "  Initializing: " << status.code << std::endl;
+    std::cout << "  Time: " << elapsedtimer.elapsed() << " ms" << std::endl;
+    if(status.code != IRPV::ReturnCode::Success) {
+        std::cout << "Vendor's error description: " << status.info << std::endl;
+        std::cout << "Can not initialize Vendor's API! Abort..." << std::endl;
+        return 7;
+    }
+    IRPV::ImageSpec imagespec;
+    if(getPreferredImageSpec(recognizer, imagespec).code != IRPV::ReturnCode::Success)
+        imagespec = IRPV::ImageSpec();
+    QImage::Format qimgtargetformat = grayscale ? QImage::Format_Grayscale8 : QImage::Format_RGB888;
+    if(imagespec.depth == 8)
+        qimgtargetformat = QImage::Format_Grayscale8;
+    else if(imagespec.depth == 24)
+        qimgtargetformat = QImage::Format_RGB888;
+
+    const QByteArray socketpathbytes = socketpath.toLocal8Bit();
+    struct sockaddr_un address;
+    std::memset(&address, 0, sizeof(address));
+    address.sun_family = AF_UNIX;
+    if(static_cast<size_t>(socketpathbytes.size()) >= sizeof(address.sun_path)) {
+        std::cerr << "Socket path is too long! Abort...";
+        return 14;
+    }
+    std::strncpy(address.sun_path, socketpathbytes.constData(), sizeof(address.sun_path) - 1);
+    if(!removeStaleSocket(address.sun_path)) { // stale socket of the previous run
+        std::cerr << "Path " << socketpath.toStdString() << " already exists and it is not a socket! Abort...";
+        return 14;
+    }
+    const int listener = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if((listener < 0) || (::bind(listener, reinterpret_cast<struct sockaddr*>(&address), sizeof(address)) != 0) || (::listen(listener, 16) != 0)) {
+        std::cerr << "Can not listen on socket " << socketpath.toStdString() << "! Abort...";
+        return 14;
+    }
+    std::cout << "Listening on " << socketpath.toStdString() << std::endl;
+
+    // Connections are accepted by the main thread, jobs are served one by one by the service thread,
+    // so the time job spends in the queue is reported separately from the time of its service
+    DaemonCaches caches(imagecachemb << 20, templatecachemb << 20);
+    std::deque<DaemonJob> jobs;
+    std::mutex mutex;
+    std::condition_variable condition;
+    bool shutdown = false;
+    std::thread service([&]() {
+        for(;;) {
+            DaemonJob _job;
+            {
+                std::unique_lock<std::mutex> _lock(mutex);
+                condition.wait(_lock, [&]() { return shutdown || !jobs.empty(); });
+                if(jobs.empty())
+                    return;
+                _job = jobs.front();
+                jobs.pop_front();
+            }
+            const qint64 _queuetime = _job.queued.nsecsElapsed();
+            sendLine(_job.socket, QJsonObject({
+                                                  qMakePair(QLatin1String("Event"),QJsonValue(QString("Started"))),
+                                                  qMakePair(QLatin1String("Job"),QJsonValue(static_cast<qint64>(_job.id))),
+                                                  qMakePair(QLatin1String("Queuetime_ms"),QJsonValue(1e-6 * _queuetime))
+                                              }));
+            QElapsedTimer _timer;
+            _timer.start();
+            // Exception of the job, thrown by Vendor's API or by memory allocation, fails the job and not the daemon
+            QJsonObject _result;
+            try {
+                _result = serveJob(recognizer, imagespec, qimgtargetformat, caches, _job.request,
+                                   [&_job](const QJsonObject &_event) { sendLine(_job.socket, _event); });
+            } catch(const std::exception &_exception) {
+                _result = QJsonObject({qMakePair(QLatin1String("Error"),QJsonValue(QString("Job has failed: %1").arg(QString::fromLocal8Bit(_exception.what()))))});
+            } catch(...) {
+                _result = QJsonObject({qMakePair(QLatin1String("Error"),QJsonValue(QString("Job has failed with unknown exception")))});
+            }
+            _result.insert(QLatin1String("Job"), QJsonValue(static_cast<qint64>(_job.id)));
+            _result.insert(QLatin1String("Queuetime_ms"), QJsonValue(1e-6 * _queuetime));
+            _result.insert(QLatin1String("Servicetime_ms"), QJsonValue(1e-6 * _timer.nsecsElapsed()));
+            _result.insert(QLatin1String("Cache"), QJsonObject({
+                               qMakePair(QLatin1String("Images"),QJsonValue(static_cast<qint64>(caches.images.size()))),
+                               qMakePair(QLatin1String("Images_bytes"),QJsonValue(static_cast<qint64>(caches.images.bytes))),
+                               qMakePair(QLatin1String("Templates"),QJsonValue(static_cast<qint64>(caches.templates.size()))),
+                               qMakePair(QLatin1String("Templates_bytes"),QJsonValue(static_cast<qint64>(caches.templates.bytes)))
+                           }));
+            sendLine(_job.socket, _result);
+            ::close(_job.socket);
+            std::cout << "Job " << _job.id << " done in " << 1e-6 * _timer.nsecsElapsed() << " ms, queued for " << 1e-6 * _queuetime << " ms" << std::endl;
+        }
+    });
+
+    size_t nextid = 0;
+    while(!shutdown) {
+        const int _socket = ::accept(listener, nullptr, nullptr);
+        if(_socket < 0)
+            continue;
+        // Request is read by the main thread, so slow or silent client should not block the others and shutdown
+        QByteArray _line;
+        QJsonParseError _error;
+        const QJsonDocument _jsondoc = QJsonDocument::fromJson(readLine(_socket, _line, 10000) ? _line : QByteArray(), &_error);
+        if((_error.error != QJsonParseError::NoError) || !_jsondoc.isObject()) {
+            sendLine(_socket, QJsonObject({qMakePair(QLatin1String("Error"),QJsonValue(QString("Request should be a JSON object")))}));
+            ::close(_socket);
+            continue;
+        }
+        const QJsonObject _request = _jsondoc.object();
+        std::lock_guard<std::mutex> _lock(mutex);
+        if(_request.value("Command").toString() == "Shutdown") {
+            shutdown = true;
+            sendLine(_socket, QJsonObject({qMakePair(QLatin1String("Event"),QJsonValue(QString("Shutdown")))}));
+            ::close(_socket);
+            break;
+        }
+        DaemonJob _job;
+        _job.socket = _socket;
+        _job.request = _request;
+        _job.queued.start();
+        _job.id = nextid++;
+        jobs.push_back(_job);
+        sendLine(_socket, QJsonObject({
+                                          qMakePair(QLatin1String("Event"),QJsonValue(QString("Queued"))),
+                                          qMakePair(QLatin1String("Job"),QJsonValue(static_cast<qint64>(_job.id))),
+                                          qMakePair(QLatin1String("Position"),QJsonValue(static_cast<qint64>(jobs.size())))
+                                      }));
+        condition.notify_one();
+    }
+    condition.notify_one();
+    service.join(); // queued jobs are served before exit
+    ::close(listener);
+    removeStaleSocket(address.sun_path);
+    return 0;
+#else
+    Q_UNUSED(socketpath) Q_UNUSED(apiresourcespath) Q_UNUSED(imagecachemb) Q_UNUSED(templatecachemb) Q_UNUSED(grayscale)
+    std::cerr << "Daemon mode is supported only on Linux! Abort...";
+    return 14;
+#endif
+}
+
+#endif // IRPVDAEMON_H
@@ -6,6 +6,14 @@
 #include <iostream>
 #include <ctime>
 #include <cstdlib>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include <functional>
+#include <deque>
+#include <limits>
 
 #include <QDateTime>
 #include <QJsonArray>
@@ -13,7 +21,25 @@
 #include <QJsonDocument>
 #include <QElapsedTimer>
 #include <QImage>
+#include <QImageReader>
+#include <QBuffer>
 #include <QDir>
+#include <QFile>
+#include <QHash>
+#include <QFileInfo>
+
+#ifdef Q_OS_LINUX
+#include <pthread.h>
+#include <sched.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <time.h>
+#endif
+
+#ifdef _OPENMP
+#include <omp.h>
+#endif
 
 #include "irpv.h"
 
@@ -23,15 +49,17 @@ struct BiometricTemplate
 {
     BiometricTemplate() {} // default constructor is needed for std::vector<BiometricTemplate>
 
-    BiometricTemplate(size_t _label, IRPV::TemplateRole _role, std::vector<uint8_t> &&_data) :
+    BiometricTemplate(size_t _label, IRPV::TemplateRole _role, std::vector<uint8_t> &&_data, bool _timedout=false) :
         label(_label),
         role(_role),
-        data(std::move(_data)) {}
+        data(std::make_shared<const std::vector<uint8_t>>(std::move(_data))),
+        timedout(_timedout) {}
 
     BiometricTemplate(BiometricTemplate&& other) :
         label(other.label),
         role(other.role),
-        data(std::move(other.data)) {}
+        data(std::move(other.data)),
+        timedout(other.timedout) {}
 
     BiometricTemplate& operator=(BiometricTemplate&& other)
     {
@@ -39,13 +67,22 @@ struct BiometricTemplate
             label = other.label;
             role = other.role;
             data = std::move(other.data);
+            timedout = other.timedout;
         }
         return *this;
     }
 
+    // Deep copy, data is allocated by the calling thread, so the copy is placed on the NUMA node of that thread
+    BiometricTemplate replica() const
+    {
+        std::vector<uint8_t> _data(data ? *data : std::vector<uint8_t>());
+        return BiometricTemplate(label, role, std::move(_data), timedout);
+    }
+
     size_t               label;
     IRPV::TemplateRole   role;
-    std::vector<uint8_t> data;
+    std::shared_ptr<const std::vector<uint8_t>> data; // shared, so watchdog executor could use template without copy
+    bool                 timedout = false; // template generation has been abandoned by watchdog, so there is no valid data
 };
 
 //---------------------------------------------------
@@ -81,17 +118,47 @@ operator<<(
 
 //---------------------------------------------------
 
-IRPV::Image readimage(const QString &_filename, QImage::Format _mTARgetformat=QImage::Format_RGB888, bool _verbose=false)
+QSize fitsize(const QSize &_size, uint16_t _maxwidth, uint16_t _maxheight)
 {
-    if(_verbose)
-        std::cout << _filename << std::endl;
+    // Returns size which fits into max dimensions with aspect ratio preserved, images are never upscaled
+    const int _maxw = (_maxwidth  > 0) ? static_cast<int>(_maxwidth)  : _size.width();
+    const int _maxh = (_maxheight > 0) ? static_cast<int>(_maxheight) : _size.height();
+    if((_size.width() <= _maxw) && (_size.height() <= _maxh))
+        return _size;
+    QSize _fitted = _size.scaled(QSize(_maxw,_maxh), Qt::KeepAspectRatio);
+    return QSize(std::max(1,_fitted.width()), std::max(1,_fitted.height()));
+}
+
+//---------------------------------------------------
 
+IRPV::Image readimage(QImageReader &_reader, QImage::Format _mTARgetformat, bool _verbose,
+                      uint16_t _maxwidth, uint16_t _maxheight)
+{
+    QSize _targetsize;
+    if((_maxwidth > 0) || (_maxheight > 0)) {
+        // Size is read from the header, so we know target size before decoding. With scaled size set
+        // JPEG decoder downscales in DCT domain and the rest is done by Qt's smooth scaler, which is
+        // SIMD-accelerated area averaging for downscale, so full-resolution frame is never materialized
+        const QSize _originalsize = _reader.size();
+        if(_originalsize.isValid()) {
+            _targetsize = fitsize(_originalsize,_maxwidth,_maxheight);
+            if(_targetsize != _originalsize)
+                _reader.setScaledSize(_targetsize);
+            else
+                _targetsize = QSize();
+        }
+    }
     QImage _qimg;
-    if(!_qimg.load(_filename)) {
+    if(!_reader.read(&_qimg)) {
         if(_verbose)
             std::cout << "Can not load or decode!!! Empty image will be returned" << std::endl;
         return IRPV::Image();
     }
+    if(_targetsize.isValid() && (_qimg.size() != _targetsize)) { // some decoders could ignore scaled size
+        _qimg = _qimg.scaled(_targetsize, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+    }
+    if(_verbose && _targetsize.isValid())
+        std::cout << " Downscaled to: " << _qimg.width() << "x" << _qimg.height() << std::endl;
 
     QImage _tmpqimg;
     if(_qimg.format() == _mTARgetformat) {
@@ -126,42 +193,223 @@ IRPV::Image readimage(const QString &_filename, QImage::Format _mTARgetformat=QI
 
 //---------------------------------------------------
 
-struct ROCPoint
+IRPV::Image readimage(const QString &_filename, QImage::Format _mTARgetformat=QImage::Format_RGB888, bool _verbose=false,
+                      uint16_t _maxwidth=0, uint16_t _maxheight=0)
 {
-    ROCPoint() {}
-    double mTAR, mFAR, similarity;
+    if(_verbose)
+        std::cout << _filename << std::endl;
+
+    QImageReader _reader(_filename);
+    return readimage(_reader,_mTARgetformat,_verbose,_maxwidth,_maxheight);
+}
+
+//---------------------------------------------------
+
+QStringList imageFileFilters()
+{
+    // Image files of the input directory, the same for the test, daemon and compare modes
+    return QStringList() << "*.jpg" << "*.jpeg" << "*.gif" << "*.png" << "*.bmp";
+}
+
+//---------------------------------------------------
+
+IRPV::ReturnStatus getPreferredImageSpec(const std::shared_ptr<IRPV::VerifInterface> &_recognizer, IRPV::ImageSpec &_spec)
+{
+    // Image spec is an optional interface, so the libraries built against the previous irpv.h are not asked for it
+    _spec = IRPV::ImageSpec();
+    IRPV::ImageSpecProvider *_provider = dynamic_cast<IRPV::ImageSpecProvider*>(_recognizer.get());
+    if(_provider == nullptr)
+        return IRPV::ReturnStatus(IRPV::ReturnCode::Success);
+    return _provider->getPreferredImageSpec(_spec);
+}
+
+//---------------------------------------------------
+
+qint64 threadCPUns()
+{
+    // CPU time consumed by the calling thread, threads spawned by Vendor's API are not counted
+#ifdef Q_OS_LINUX
+    struct timespec _ts;
+    if(clock_gettime(CLOCK_THREAD_CPUTIME_ID, &_ts) == 0)
+        return static_cast<qint64>(_ts.tv_sec) * 1000000000LL + _ts.tv_nsec;
+#endif
+    return 0;
+}
+
+//---------------------------------------------------
+
+qint64 processCPUns()
+{
+    // CPU time consumed by all threads of the process, so it includes Vendor's internal pools
+#ifdef Q_OS_LINUX
+    struct timespec _ts;
+    if(clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &_ts) == 0)
+        return static_cast<qint64>(_ts.tv_sec) * 1000000000LL + _ts.tv_nsec;
+#endif
+    return 0;
+}
+
+//---------------------------------------------------
+
+struct ImageJob
+{
+    ImageJob() {}
+
+    ImageJob(const QString &_filename, size_t _label, IRPV::TemplateRole _role, const QString &_labelname) :
+        filename(_filename),
+        label(_label),
+        role(_role),
+        labelname(_labelname) {}
+
+    QString            filename;
+    size_t             label;
+    IRPV::TemplateRole role;
+    QString            labelname; // subdir name for persons, file name for distractors
 };
 
 //---------------------------------------------------
 
-std::vector<ROCPoint> computeROC(size_t _points, const std::vector<uint8_t> &_issameperson,
-                                 size_t _totalpositive, size_t _totalnegative,
-                                 const std::vector<double> &_similarity, uint _confexamples)
+class ImageLoader
 {
-    std::vector<ROCPoint> _vROC(_points,ROCPoint());
+public:
+    // Files are loaded and decoded by the pool of _threads in the order they have been provided,
+    // decoded images are kept in the bounded queue of _queuedepth size, kernel is asked
+    // to read ahead _readahead files beyond the one being loaded
+    ImageLoader(const std::vector<QString> &_files, QImage::Format _format, uint16_t _maxwidth, uint16_t _maxheight,
+                size_t _threads, size_t _queuedepth, size_t _readahead) :
+        readtime(_files.size(),0),
+        decodetime(_files.size(),0),
+        files(_files),
+        format(_format),
+        maxwidth(_maxwidth),
+        maxheight(_maxheight),
+        readahead(_readahead),
+        queue(std::max<size_t>(1,_queuedepth)),
+        ready(std::max<size_t>(1,_queuedepth),0),
+        nextload(0),
+        nextconsume(0),
+        stopped(false),
+        cputime(0)
+    {
+        for(size_t i = 0; i < std::min(readahead, files.size()); ++i)
+            adviseWillNeed(files[i]);
+        for(size_t i = 0; i < std::max<size_t>(1,_threads); ++i)
+            threads.push_back(std::thread(&ImageLoader::run, this));
+    }
 
-    const double _maxsim = *std::max_element(_similarity.begin(), _similarity.end());
-    const double _minsim = *std::min_element(_similarity.begin(), _similarity.end());
-    const double _simstep = (_maxsim - _minsim)/_points;
+    ~ImageLoader()
+    {
+        {
+            std::lock_guard<std::mutex> _lock(mutex);
+            stopped = true;
+        }
+        loadcondition.notify_all();
+        for(size_t i = 0; i < threads.size(); ++i)
+            threads[i].join();
+    }
 
-    #pragma omp parallel for
-    for(int i = 0; i < static_cast<int>(_points); ++i) { // openmp demands signed integral type to be used
-        const double _thresh = _minsim + i*_simstep;
-        uint8_t _same;
-        size_t  _truepositive = 0, _truenegative = 0;
-        for(size_t j = 0; j < _similarity.size(); ++j) {
-            _same = (_similarity[j] < _thresh) ? 0 : 1; // 1 - same, 0 - not the same
-            if((_same == 1) && (_issameperson[j] == 1))
-                _truepositive++;
-            else if((_same == 0) && (_issameperson[j] == 0))
-                _truenegative++;
-        }
-        _vROC[i].mTAR = std::min(static_cast<double>(_truepositive) / _totalpositive, static_cast<double>(_totalpositive-_confexamples) / _totalpositive);
-        _vROC[i].mFAR = std::max(static_cast<double>(_totalnegative - _truenegative) / _totalnegative, static_cast<double>(_confexamples) / _totalnegative);
-        _vROC[i].similarity = _thresh;
+    // Blocks until the next image in order is decoded, should be called once per file
+    IRPV::Image next()
+    {
+        std::unique_lock<std::mutex> _lock(mutex);
+        const size_t _slot = nextconsume % queue.size();
+        readycondition.wait(_lock, [this,_slot]() { return ready[_slot] != 0; });
+        IRPV::Image _img = std::move(queue[_slot]);
+        queue[_slot] = IRPV::Image();
+        ready[_slot] = 0;
+        nextconsume++;
+        _lock.unlock();
+        loadcondition.notify_all();
+        return _img;
     }
-    return _vROC;
-}
+
+    std::vector<double> readtime;   // ns spent in reading of each file, valid for consumed files
+    std::vector<double> decodetime; // ns spent in decoding and preprocessing of each file, valid for consumed files
+
+    // CPU time of the loader threads of the files loaded so far, so it could be excluded from process CPU time
+    qint64 cpuns() const
+    {
+        return cputime.load();
+    }
+
+private:
+    void run()
+    {
+        QElapsedTimer _timer;
+        for(;;) {
+            size_t _index;
+            {
+                std::unique_lock<std::mutex> _lock(mutex);
+                loadcondition.wait(_lock, [this]() {
+                    return stopped || ((nextload < files.size()) && (nextload < nextconsume + queue.size()));
+                });
+                if(stopped || (nextload >= files.size()))
+                    return;
+                _index = nextload++;
+            }
+            if(_index + readahead < files.size())
+                adviseWillNeed(files[_index + readahead]);
+
+            const qint64 _cpustart = threadCPUns();
+            _timer.start();
+            QFile _file(files[_index]);
+            QByteArray _bytes;
+            if(_file.open(QFile::ReadOnly))
+                _bytes = _file.readAll();
+            readtime[_index] = _timer.nsecsElapsed();
+
+            _timer.start();
+            QBuffer _buffer(&_bytes);
+            _buffer.open(QBuffer::ReadOnly);
+            QImageReader _reader(&_buffer);
+            IRPV::Image _img = readimage(_reader,format,false,maxwidth,maxheight);
+            decodetime[_index] = _timer.nsecsElapsed();
+            cputime += threadCPUns() - _cpustart;
+
+            {
+                std::lock_guard<std::mutex> _lock(mutex);
+                queue[_index % queue.size()] = std::move(_img);
+                ready[_index % queue.size()] = 1;
+            }
+            readycondition.notify_all();
+        }
+    }
+
+    static void adviseWillNeed(const QString &_filename)
+    {
+        // Asynchronous readahead into the page cache, the call itself does not wait for disk
+#ifdef Q_OS_LINUX
+        const int _fd = ::open(_filename.toLocal8Bit().constData(), O_RDONLY);
+        if(_fd >= 0) {
+            ::posix_fadvise(_fd, 0, 0, POSIX_FADV_WILLNEED);
+            ::close(_fd);
+        }
+#else
+        Q_UNUSED(_filename)
+#endif
+    }
+
+    std::vector<QString>     files;
+    QImage::Format           format;
+    uint16_t                 maxwidth, maxheight;
+    size_t                   readahead;
+    std::vector<IRPV::Image> queue;
+    std::vector<uint8_t>     ready;
+    size_t                   nextload, nextconsume;
+    bool                     stopped;
+    std::atomic<qint64>      cputime; // ns
+    std::mutex               mutex;
+    std::condition_variable  loadcondition, readycondition;
+    std::vector<std::thread> threads;
+};
+
+//---------------------------------------------------
+
+struct ROCPoint
+{
+    ROCPoint() {}
+    double mTAR, mFAR, similarity;
+};
 
 //---------------------------------------------------
 
@@ -176,13 +424,170 @@ double findArea(const std::vector<ROCPoint> &_roc)
 
 //---------------------------------------------------
 
-double findFRR(const std::vector<ROCPoint> &_roc, double _targetmFAR)
+// Moves genuine scores to the front of _similarity keeping _issameperson in step, returns the number of genuine scores
+size_t partitionScores(std::vector<double> &_similarity, std::vector<uint8_t> &_issameperson)
+{
+    size_t _lo = 0, _hi = _similarity.size();
+    while(true) {
+        while((_lo < _hi) && (_issameperson[_lo] == 1))
+            ++_lo;
+        while((_lo < _hi) && (_issameperson[_hi-1] != 1))
+            --_hi;
+        if(_lo >= _hi)
+            break;
+        std::swap(_similarity[_lo], _similarity[_hi-1]);
+        std::swap(_issameperson[_lo], _issameperson[_hi-1]);
+        ++_lo;
+        --_hi;
+    }
+    return _lo;
+}
+
+//--------------------------------------------------
+
+// Read only view of contiguous scores, storage is owned by the caller
+struct ScoreRange
+{
+    ScoreRange(const double *_first=nullptr, size_t _count=0) : first(_first), count(_count) {}
+    const double *begin() const {return first;}
+    const double *end() const {return first + count;}
+    size_t size() const {return count;}
+    bool empty() const {return count == 0;}
+    double front() const {return first[0];}
+    double back() const {return first[count-1];}
+    double operator[](size_t _i) const {return first[_i];}
+
+    const double *first;
+    size_t count;
+};
+
+//--------------------------------------------------
+
+class ScoreDistribution
+{
+public:
+    // _similarity should be partitioned by partitionScores, genuine and impostor ranges are sorted in place once,
+    // so FAR and FRR at any threshold are counted by binary search, _similarity should outlive the distribution
+    ScoreDistribution(std::vector<double> &_similarity, size_t _genuine)
+    {
+        std::sort(_similarity.begin(), _similarity.begin() + _genuine);
+        std::sort(_similarity.begin() + _genuine, _similarity.end());
+        genuine = ScoreRange(_similarity.data(), _genuine);
+        impostor = ScoreRange(_similarity.data() + _genuine, _similarity.size() - _genuine);
+    }
+
+    // Share of impostor scores accepted, scores equal to threshold are accepted as in computeROC
+    double far(double _thresh) const
+    {
+        if(impostor.empty())
+            return 0;
+        return static_cast<double>(impostor.end() - std::lower_bound(impostor.begin(), impostor.end(), _thresh)) / impostor.size();
+    }
+
+    // Share of genuine scores rejected
+    double frr(double _thresh) const
+    {
+        if(genuine.empty())
+            return 0;
+        return static_cast<double>(std::lower_bound(genuine.begin(), genuine.end(), _thresh) - genuine.begin()) / genuine.size();
+    }
+
+    // Lowest threshold at which no more than _accepted impostor scores are accepted
+    double thresholdFor(size_t _accepted) const
+    {
+        if(_accepted >= impostor.size())
+            return impostor.empty() ? 0 : impostor.front();
+        const double _rejected = impostor[impostor.size() - _accepted - 1]; // the highest impostor score which should be rejected
+        return std::nextafter(_rejected, std::numeric_limits<double>::infinity());
+    }
+
+    // FRR interpolated between two operating points around the target FAR
+    double frrAtFAR(double _targetFAR) const
+    {
+        if(impostor.empty() || genuine.empty())
+            return 1.0;
+        const size_t _accepted = static_cast<size_t>(std::floor(std::max(0.0, _targetFAR) * impostor.size()));
+        const double _lothresh = thresholdFor(_accepted);
+        const double _lofar = far(_lothresh), _lofrr = frr(_lothresh);
+        if((_accepted >= impostor.size()) || (_lofar >= _targetFAR))
+            return _lofrr;
+        const double _hithresh = impostor[impostor.size() - _accepted - 1];
+        const double _hifar = far(_hithresh), _hifrr = frr(_hithresh);
+        return _lofrr + (_hifrr - _lofrr) * (_targetFAR - _lofar) / (_hifar - _lofar);
+    }
+
+    // Equal error rate, FAR - FRR decreases with threshold, so crossing is found by binary search over impostor scores
+    double eer() const
+    {
+        if(impostor.empty() || genuine.empty())
+            return 1.0;
+        size_t _lo = 0, _hi = impostor.size() - 1;
+        if(far(impostor[_hi]) - frr(impostor[_hi]) >= 0)
+            return 0.5 * (far(impostor[_hi]) + frr(impostor[_hi]));
+        while(_hi - _lo > 1) {
+            const size_t _mid = _lo + (_hi - _lo) / 2;
+            if(far(impostor[_mid]) - frr(impostor[_mid]) >= 0)
+                _lo = _mid;
+            else
+                _hi = _mid;
+        }
+        const double _dlo = far(impostor[_lo]) - frr(impostor[_lo]);
+        const double _dhi = far(impostor[_hi]) - frr(impostor[_hi]);
+        const double _t = (_dlo > _dhi) ? _dlo / (_dlo - _dhi) : 0;
+        return (1 - _t) * 0.5 * (far(impostor[_lo]) + frr(impostor[_lo])) + _t * 0.5 * (far(impostor[_hi]) + frr(impostor[_hi]));
+    }
+
+    ScoreRange genuine, impostor; // sorted ascending
+};
+
+//--------------------------------------------------
+
+std::vector<ROCPoint> computeROC(size_t _points, const ScoreDistribution &_scores, uint _confexamples)
+{
+    // Thresholds are spaced evenly between the lowest and the highest score, every point is counted by binary search
+    std::vector<ROCPoint> _vROC(_points,ROCPoint());
+    const size_t _totalpositive = _scores.genuine.size(), _totalnegative = _scores.impostor.size();
+    if((_totalpositive == 0) && (_totalnegative == 0))
+        return _vROC;
+    const double _maxsim = _scores.genuine.empty() ? _scores.impostor.back()
+                                                   : (_scores.impostor.empty() ? _scores.genuine.back() : std::max(_scores.genuine.back(), _scores.impostor.back()));
+    const double _minsim = _scores.genuine.empty() ? _scores.impostor.front()
+                                                   : (_scores.impostor.empty() ? _scores.genuine.front() : std::min(_scores.genuine.front(), _scores.impostor.front()));
+    const double _simstep = (_maxsim - _minsim)/_points;
+    for(size_t i = 0; i < _points; ++i) {
+        const double _thresh = _minsim + i*_simstep;
+        _vROC[i].mTAR = std::min(1.0 - _scores.frr(_thresh), static_cast<double>(_totalpositive-_confexamples) / _totalpositive);
+        _vROC[i].mFAR = std::max(_scores.far(_thresh), static_cast<double>(_confexamples) / _totalnegative);
+        _vROC[i].similarity = _thresh;
+    }
+    return _vROC;
+}
+
+//--------------------------------------------------
+
+std::vector<ROCPoint> computeLogROC(size_t _points, const ScoreDistribution &_scores, uint _confexamples)
 {
-    for(size_t i = 0; i < _roc.size()-1; ++i) { // not to 0 because of unsigned data type, we will hadle last value in final return
-        if((_roc[i].mFAR - _targetmFAR)*(_roc[i+1].mFAR - _targetmFAR) < 0)
-            return 1.0 - _roc[i].mTAR;
+    // Thresholds are placed on impostor scores quantiles with FAR spaced logarithmically from 1 down to 1/negatives,
+    // so low FAR region gets as many points as high FAR one, points which give the same threshold are merged
+    std::vector<ROCPoint> _vROC;
+    const size_t _totalpositive = _scores.genuine.size(), _totalnegative = _scores.impostor.size();
+    if((_points < 2) || (_totalpositive == 0) || (_totalnegative == 0))
+        return _vROC;
+    _vROC.reserve(_points);
+    const double _logstep = std::log(static_cast<double>(_totalnegative)) / (_points - 1);
+    size_t _previous = _totalnegative + 1;
+    for(size_t i = 0; i < _points; ++i) {
+        const size_t _accepted = static_cast<size_t>(std::floor(_totalnegative * std::exp(-_logstep * i) + 1e-9));
+        if(_accepted == _previous)
+            continue;
+        _previous = _accepted;
+        ROCPoint _point;
+        _point.similarity = _scores.thresholdFor(_accepted);
+        _point.mTAR = std::min(1.0 - _scores.frr(_point.similarity), static_cast<double>(_totalpositive-_confexamples) / _totalpositive);
+        _point.mFAR = std::max(_scores.far(_point.similarity), static_cast<double>(_confexamples) / _totalnegative);
+        _vROC.push_back(_point);
     }
-    return 1.0;
+    return _vROC;
 }
 
 //--------------------------------------------------
@@ -210,6 +615,1011 @@ QJsonArray serializeROC(const std::vector<ROCPoint> &_roc)
     return _jsonarr;
 }
 
+//---------------------------------------------------
+
+struct LatencyProfile
+{
+    LatencyProfile(size_t _warmup=0, size_t _firstk=0, size_t _total=0, size_t _seriespoints=0, double _slathreshold=0) :
+        warmup(_warmup),
+        firstk(_firstk),
+        bucketwidth(_seriespoints > 0 ? std::max<size_t>(1, (_total + _seriespoints - 1) / _seriespoints) : 0),
+        bucketcalls(0),
+        bucketsum(0),
+        calls(0),
+        steadycalls(0),
+        steadysum(0),
+        steadysqsum(0),
+        steadymin(0),
+        steadymax(0),
+        slathreshold(_slathreshold),
+        slaviolations(0)
+    {
+        firstcalls.reserve(_firstk);
+        if(bucketwidth > 0)
+            series.reserve(_seriespoints);
+    }
+
+    // Should be called once per measured call in the order of calls, _violation forces the call to be counted over SLA
+    void add(double _ns, bool _violation=false)
+    {
+        if(_violation || ((slathreshold > 0) && (_ns > slathreshold)))
+            slaviolations++;
+        if(calls < firstk)
+            firstcalls.push_back(_ns);
+        if(bucketwidth > 0) { // time series is stored as mean latency over consecutive buckets of calls
+            bucketsum += _ns;
+            if(++bucketcalls == bucketwidth) {
+                series.push_back(bucketsum / bucketcalls);
+                bucketsum = 0;
+                bucketcalls = 0;
+            }
+        }
+        if(calls >= warmup) { // warm-up calls are excluded from steady-state figures
+            if(steadycalls == 0) {
+                steadymin = _ns;
+                steadymax = _ns;
+            } else {
+                steadymin = std::min(steadymin, _ns);
+                steadymax = std::max(steadymax, _ns);
+            }
+            steadysum += _ns;
+            steadysqsum += _ns * _ns;
+            steadycalls++;
+        }
+        calls++;
+    }
+
+    // Flushes incomplete bucket, should be called after the last call
+    void finish()
+    {
+        if(bucketcalls > 0) {
+            series.push_back(bucketsum / bucketcalls);
+            bucketsum = 0;
+            bucketcalls = 0;
+        }
+    }
+
+    double steadymean() const
+    {
+        return steadycalls > 0 ? steadysum / steadycalls : 0;
+    }
+
+    double steadystdev() const
+    {
+        if(steadycalls < 2)
+            return 0;
+        const double _mean = steadymean();
+        return std::sqrt(std::max(0.0, (steadysqsum - steadycalls * _mean * _mean) / (steadycalls - 1)));
+    }
+
+    size_t              warmup, firstk;
+    std::vector<double> firstcalls; // latency of the first K calls in ns
+    std::vector<double> series;     // mean latency in ns for each bucket of calls
+    size_t              bucketwidth, bucketcalls;
+    double              bucketsum;
+    size_t              calls, steadycalls;
+    double              steadysum, steadysqsum, steadymin, steadymax;
+    double              slathreshold; // ns, 0 means SLA is not set
+    size_t              slaviolations;
+};
+
+//---------------------------------------------------
+
+QJsonObject serializeLatency(const LatencyProfile &_profile, double _nsscale, const QString &_units)
+{
+    QJsonArray _firstcalls;
+    for(size_t i = 0; i < _profile.firstcalls.size(); ++i)
+        _firstcalls.push_back(QJsonValue(_profile.firstcalls[i] * _nsscale));
+    QJsonArray _series;
+    for(size_t i = 0; i < _profile.series.size(); ++i)
+        _series.push_back(QJsonValue(_profile.series[i] * _nsscale));
+    QJsonObject _steady({
+                            qMakePair(QString("Calls"),QJsonValue(static_cast<qint64>(_profile.steadycalls))),
+                            qMakePair(QString("Mean_%1").arg(_units),QJsonValue(_profile.steadymean() * _nsscale)),
+                            qMakePair(QString("Stdev_%1").arg(_units),QJsonValue(_profile.steadystdev() * _nsscale)),
+                            qMakePair(QString("Min_%1").arg(_units),QJsonValue(_profile.steadymin * _nsscale)),
+                            qMakePair(QString("Max_%1").arg(_units),QJsonValue(_profile.steadymax * _nsscale))
+                        });
+    QJsonObject _jsonobj({
+                             qMakePair(QString("Warmup"),QJsonValue(static_cast<qint64>(std::min(_profile.warmup,_profile.calls)))),
+                             qMakePair(QString("Firstcalls_%1").arg(_units),QJsonValue(_firstcalls)),
+                             qMakePair(QString("Seriesstep"),QJsonValue(static_cast<qint64>(_profile.bucketwidth))),
+                             qMakePair(QString("Series_%1").arg(_units),QJsonValue(_series)),
+                             qMakePair(QString("Steady"),QJsonValue(_steady))
+                         });
+    if((_profile.slathreshold > 0) || (_profile.slaviolations > 0)) {
+        QJsonObject _sla({
+                             qMakePair(QString("Threshold_%1").arg(_units),QJsonValue(_profile.slathreshold * _nsscale)),
+                             qMakePair(QString("Violations"),QJsonValue(static_cast<qint64>(_profile.slaviolations))),
+                             qMakePair(QString("Fraction"),QJsonValue(_profile.calls > 0 ? static_cast<double>(_profile.slaviolations) / _profile.calls : 0.0))
+                         });
+        _jsonobj.insert(QString("SLA"),QJsonValue(_sla));
+    }
+    return _jsonobj;
+}
+
+//---------------------------------------------------
+
+std::vector<int> parseCPUList(const QString &_cpulist)
+{
+    // Linux cpulist format, for the instance: 0-3,8,10-11
+    std::vector<int> _cpus;
+    const QStringList _ranges = _cpulist.trimmed().split(',');
+    for(int i = 0; i < _ranges.size(); ++i) {
+        if(_ranges.at(i).trimmed().isEmpty())
+            continue;
+        const QStringList _bounds = _ranges.at(i).split('-');
+        bool _okfrom = false, _okto = false;
+        const int _from = _bounds.at(0).trimmed().toInt(&_okfrom);
+        const int _to = (_bounds.size() > 1) ? _bounds.at(1).trimmed().toInt(&_okto) : _from;
+        if(!_okfrom || (_bounds.size() > 1 && !_okto) || _from < 0 || _to < _from)
+            return std::vector<int>();
+        for(int j = _from; j <= _to; ++j)
+            _cpus.push_back(j);
+    }
+    return _cpus;
+}
+
+//---------------------------------------------------
+
+QJsonArray serializeCPUList(const std::vector<int> &_cpus)
+{
+    QJsonArray _jsonarr;
+    for(size_t i = 0; i < _cpus.size(); ++i)
+        _jsonarr.push_back(QJsonValue(_cpus[i]));
+    return _jsonarr;
+}
+
+//---------------------------------------------------
+
+std::vector<std::vector<int>> readNUMATopology()
+{
+    // Returns cpus for each NUMA node, if topology is not available all cpus are reported as node 0
+    std::vector<std::vector<int>> _nodes;
+#ifdef Q_OS_LINUX
+    for(int _node = 0; ; ++_node) {
+        QFile _cpulistfile(QString("/sys/devices/system/node/node%1/cpulist").arg(_node));
+        if(!_cpulistfile.open(QFile::ReadOnly))
+            break;
+        _nodes.push_back(parseCPUList(QString::fromLocal8Bit(_cpulistfile.readAll())));
+    }
+#endif
+    if(_nodes.empty()) {
+        std::vector<int> _cpus;
+        for(int i = 0; i < static_cast<int>(std::thread::hardware_concurrency()); ++i)
+            _cpus.push_back(i);
+        _nodes.push_back(_cpus);
+    }
+    return _nodes;
+}
+
+//---------------------------------------------------
+
+int findNUMANode(const std::vector<std::vector<int>> &_topology, int _cpu)
+{
+    for(size_t i = 0; i < _topology.size(); ++i)
+        if(std::find(_topology[i].begin(), _topology[i].end(), _cpu) != _topology[i].end())
+            return static_cast<int>(i);
+    return -1;
+}
+
+//---------------------------------------------------
+
+bool pinCurrentThread(const std::vector<int> &_cpus)
+{
+    // Threads that will be created by the current thread afterwards (vendor's pools, OpenMP team) inherit this mask
+    // and all memory allocated after pinning is placed on the local NUMA node by the first-touch policy
+#ifdef Q_OS_LINUX
+    if(_cpus.empty())
+        return false;
+    cpu_set_t _cpuset;
+    CPU_ZERO(&_cpuset);
+    for(size_t i = 0; i < _cpus.size(); ++i) {
+        if(_cpus[i] >= CPU_SETSIZE)
+            return false;
+        CPU_SET(_cpus[i], &_cpuset);
+    }
+    return pthread_setaffinity_np(pthread_self(), sizeof(cpu_set_t), &_cpuset) == 0;
+#else
+    Q_UNUSED(_cpus)
+    return false;
+#endif
+}
+
+//---------------------------------------------------
+
+struct WorkerPlacement
+{
+    std::vector<int>              nodes; // NUMA node of each cpu set, -1 if topology is unknown
+    std::vector<std::vector<int>> cpus;  // cpu sets workers are pinned to in round-robin order
+    std::vector<std::shared_ptr<IRPV::VerifInterface>> recognizers; // Vendor's API instance of each cpu set, empty if instance is shared
+
+    size_t slot(size_t _worker) const
+    {
+        return cpus.empty() ? 0 : _worker % cpus.size();
+    }
+
+    // Should be called by the worker itself before it allocates its buffers and calls Vendor's API
+    void pin(size_t _worker) const
+    {
+        if(!cpus.empty())
+            pinCurrentThread(cpus[slot(_worker)]);
+    }
+
+    std::shared_ptr<IRPV::VerifInterface> recognizer(size_t _worker, const std::shared_ptr<IRPV::VerifInterface> &_shared) const
+    {
+        return recognizers.empty() ? _shared : recognizers[slot(_worker)];
+    }
+};
+
+//---------------------------------------------------
+
+WorkerPlacement makeWorkerPlacement(const std::vector<std::vector<int>> &_topology, const std::vector<int> &_pinnedcpus)
+{
+    // Workers are spread over NUMA nodes and each one is pinned to the cpus of its node allowed for the harness,
+    // so Vendor's threads spawned by the worker and the memory it touches first stay on the same node
+    WorkerPlacement _placement;
+    for(size_t n = 0; n < _topology.size(); ++n) {
+        std::vector<int> _cpus;
+        for(size_t i = 0; i < _topology[n].size(); ++i)
+            if(_pinnedcpus.empty() || (std::find(_pinnedcpus.begin(), _pinnedcpus.end(), _topology[n][i]) != _pinnedcpus.end()))
+                _cpus.push_back(_topology[n][i]);
+        if(!_cpus.empty()) {
+            _placement.nodes.push_back(static_cast<int>(n));
+            _placement.cpus.push_back(_cpus);
+        }
+    }
+    if(_placement.cpus.empty() && !_pinnedcpus.empty()) {
+        _placement.nodes.push_back(-1);
+        _placement.cpus.push_back(_pinnedcpus);
+    }
+    return _placement;
+}
+
+//---------------------------------------------------
+
+class NodeTemplates
+{
+public:
+    // Every matching worker reads all enrollment templates, so if workers are spread over several NUMA nodes
+    // each node gets its own replica. Replica is copied by the first worker of the node after it has been pinned,
+    // so its pages are allocated on the node, other workers of the node wait until the copy is done
+    NodeTemplates(const std::vector<BiometricTemplate> &_templates, const WorkerPlacement &_placement) :
+        templates(_templates),
+        replicas(_placement.cpus.size() > 1 ? _placement.cpus.size() : 0),
+        flags(new std::once_flag[replicas.size()]) {}
+
+    const std::vector<BiometricTemplate>& local(size_t _slot)
+    {
+        if(replicas.empty())
+            return templates;
+        std::call_once(flags[_slot], [this,_slot]() {
+            replicas[_slot].reserve(templates.size());
+            for(size_t i = 0; i < templates.size(); ++i)
+                replicas[_slot].push_back(templates[i].replica());
+        });
+        return replicas[_slot];
+    }
+
+    size_t replicascount() const
+    {
+        return replicas.size();
+    }
+
+private:
+    const std::vector<BiometricTemplate>        &templates;
+    std::vector<std::vector<BiometricTemplate>> replicas;
+    std::unique_ptr<std::once_flag[]>           flags;
+};
+
+//---------------------------------------------------
+
+std::atomic<int>& vendorThreadsLimit()
+{
+    static std::atomic<int> _limit(0); // 0 means Vendor's API decides by itself
+    return _limit;
+}
+
+//---------------------------------------------------
+
+void applyVendorThreadsLimit()
+{
+    // OpenMP number of threads is a per-thread setting, so it should be applied
+    // by each harness thread which calls Vendor's API before the first call
+#ifdef _OPENMP
+    if(vendorThreadsLimit() > 0)
+        omp_set_num_threads(vendorThreadsLimit());
+#endif
+}
+
+//---------------------------------------------------
+
+IRPV::ReturnStatus initializeNodeRecognizers(WorkerPlacement &_placement, const std::string &_resources)
+{
+    // Each instance is created by the thread pinned to the cpus of its node, so Vendor's model is allocated there.
+    // Instances are initialized one by one, because Vendor's initialize is not required to be thread safe
+    IRPV::ReturnStatus _status(IRPV::ReturnCode::Success);
+    for(size_t s = 0; s < _placement.cpus.size(); ++s) {
+        std::shared_ptr<IRPV::VerifInterface> _recognizer;
+        std::thread _thread([&]() {
+            pinCurrentThread(_placement.cpus[s]);
+            applyVendorThreadsLimit();
+            _recognizer = IRPV::VerifInterface::getImplementation();
+            _status = _recognizer->initialize(_resources);
+        });
+        _thread.join();
+        if(_status.code != IRPV::ReturnCode::Success) {
+            _placement.recognizers.clear();
+            return _status;
+        }
+        _placement.recognizers.push_back(_recognizer);
+    }
+    return _status;
+}
+
+//---------------------------------------------------
+
+void setVendorThreadsLimit(int _threads)
+{
+    // Environment is read by the most of threading runtimes on initialization,
+    // so it has effect only if set before Vendor's API has been initialized.
+    // Calling thread is not limited, harness threads apply the limit by themselves
+    vendorThreadsLimit() = _threads;
+    if(_threads > 0) {
+        const QByteArray _value = QByteArray::number(_threads);
+        qputenv("OMP_NUM_THREADS", _value);
+        qputenv("MKL_NUM_THREADS", _value);
+        qputenv("OPENBLAS_NUM_THREADS", _value);
+        qputenv("TF_NUM_INTRAOP_THREADS", _value);
+    }
+}
+
+//---------------------------------------------------
+
+int harnessThreads()
+{
+    // OpenMP threads of the calling thread, so they could be restored for the harness own parallel loops
+#ifdef _OPENMP
+    return omp_get_max_threads();
+#else
+    return 0;
+#endif
+}
+
+//---------------------------------------------------
+
+void restoreHarnessThreads(int _threads)
+{
+#ifdef _OPENMP
+    if(_threads > 0)
+        omp_set_num_threads(_threads);
+#else
+    Q_UNUSED(_threads)
+#endif
+}
+
+//---------------------------------------------------
+
+class ProgressReporter
+{
+public:
+    // Progress is printed by background thread every _periodsec seconds, so workers do no I/O in hot loops
+    ProgressReporter(const std::string &_title, size_t _total, const std::string &_units, uint _periodsec) :
+        title(_title),
+        units(_units),
+        total(_total),
+        period(_periodsec),
+        done(0),
+        errors(0),
+        stopped(false)
+    {
+        if(period > 0)
+            thread = std::thread(&ProgressReporter::run, this);
+    }
+
+    ~ProgressReporter()
+    {
+        stop();
+    }
+
+    // Lock-free, could be called from any worker
+    void itemDone(bool _error)
+    {
+        done.fetch_add(1, std::memory_order_relaxed);
+        if(_error)
+            errors.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void stop()
+    {
+        {
+            std::lock_guard<std::mutex> _lock(mutex);
+            if(stopped)
+                return;
+            stopped = true;
+        }
+        condition.notify_all();
+        if(thread.joinable())
+            thread.join();
+    }
+
+private:
+    void run()
+    {
+        std::chrono::steady_clock::time_point _last = std::chrono::steady_clock::now();
+        size_t _lastdone = 0, _lasterrors = 0;
+        std::unique_lock<std::mutex> _lock(mutex);
+        while(!condition.wait_for(_lock, std::chrono::seconds(period), [this]() { return stopped; })) {
+            const std::chrono::steady_clock::time_point _now = std::chrono::steady_clock::now();
+            const size_t _done = done.load(std::memory_order_relaxed);
+            const size_t _errors = errors.load(std::memory_order_relaxed);
+            const double _seconds = std::chrono::duration<double>(_now - _last).count();
+            const double _rate = _seconds > 0 ? (_done - _lastdone) / _seconds : 0;
+            const double _errorrate = (_done > _lastdone) ? static_cast<double>(_errors - _lasterrors) / (_done - _lastdone) : 0;
+            std::cout << "  " << title << ": " << _done << " / " << total
+                      << " (" << QString::number(100.0 * _done / std::max<size_t>(1, total), 'f', 1) << " %)"
+                      << " | " << QString::number(_rate, 'f', 1) << " " << units << "/s"
+                      << " | errors: " << QString::number(100.0 * _errorrate, 'f', 2) << " %"
+                      << " | ETA: ";
+            if(_rate > 0) {
+                const qint64 _eta = static_cast<qint64>((total - std::min(total, _done)) / _rate);
+                std::cout << _eta / 3600 << "h " << (_eta % 3600) / 60 << "m " << _eta % 60 << "s";
+            } else {
+                std::cout << "unknown";
+            }
+            std::cout << '\n' << std::flush;
+            _last = _now;
+            _lastdone = _done;
+            _lasterrors = _errors;
+        }
+    }
+
+    std::string             title, units;
+    size_t                  total;
+    uint                    period;
+    std::atomic<size_t>     done, errors;
+    std::thread             thread;
+    std::mutex              mutex;
+    std::condition_variable condition;
+    bool                    stopped;
+};
+
+//---------------------------------------------------
+
+template<typename Call>
+IRPV::ReturnStatus guardedCall(const Call &_call)
+{
+    // Exception thrown by Vendor's API inside of the harness worker thread would terminate the process,
+    // so it is turned to the error status of the call
+    try {
+        return _call();
+    } catch(const std::exception &_exception) {
+        return IRPV::ReturnStatus(IRPV::ReturnCode::VendorError, std::string("Exception: ") + _exception.what());
+    } catch(...) {
+        return IRPV::ReturnStatus(IRPV::ReturnCode::VendorError, "Unknown exception");
+    }
+}
+
+//---------------------------------------------------
+
+class CallWatchdog
+{
+public:
+    // Vendor's calls are executed by the separate thread, if call does not return before deadline
+    // the thread is abandoned (detached with its own copy of the input data) and the new one is started
+    explicit CallWatchdog(const std::shared_ptr<IRPV::VerifInterface> &_recognizer) :
+        recognizer(_recognizer)
+    {
+        spawn();
+    }
+
+    ~CallWatchdog()
+    {
+        {
+            std::lock_guard<std::mutex> _lock(state->mutex);
+            state->stop = true;
+        }
+        state->condition.notify_all();
+        executor.join();
+    }
+
+    // Returns false if call has been abandoned, output is valid only when true is returned
+    bool createTemplate(const IRPV::Image &_img, IRPV::TemplateRole _role, std::vector<uint8_t> &_templ,
+                        IRPV::ReturnStatus &_status, qint64 _deadlinens)
+    {
+        const std::shared_ptr<IRPV::VerifInterface> _recognizer = recognizer;
+        const std::shared_ptr<std::vector<uint8_t>> _output = std::make_shared<std::vector<uint8_t>>();
+        if(!call([_recognizer,_img,_role,_output]() { return _recognizer->createTemplate(_img,_role,*_output); }, _deadlinens, _status))
+            return false;
+        _templ = std::move(*_output);
+        return true;
+    }
+
+    // Returns false if call has been abandoned, output is valid only when true is returned
+    // Templates are shared with the executor, so abandoned call could still use them and nothing is copied per call
+    bool matchTemplates(const std::shared_ptr<const std::vector<uint8_t>> &_verifTemplate, const std::shared_ptr<const std::vector<uint8_t>> &_enrollTemplate,
+                        double &_similarity, IRPV::ReturnStatus &_status, qint64 _deadlinens)
+    {
+        const std::shared_ptr<IRPV::VerifInterface> _recognizer = recognizer;
+        const std::shared_ptr<double> _output = std::make_shared<double>(0);
+        if(!call([_recognizer,_verifTemplate,_enrollTemplate,_output]() { return _recognizer->matchTemplates(*_verifTemplate,*_enrollTemplate,*_output); },
+                 _deadlinens, _status))
+            return false;
+        _similarity = *_output;
+        return true;
+    }
+
+private:
+    struct State
+    {
+        State() : pending(false), finished(false), abandoned(false), stop(false) {}
+
+        std::mutex                            mutex;
+        std::condition_variable               condition;
+        std::function<IRPV::ReturnStatus()>   task;
+        IRPV::ReturnStatus                    status;
+        bool                                  pending, finished, abandoned, stop;
+    };
+
+    bool call(const std::function<IRPV::ReturnStatus()> &_task, qint64 _deadlinens, IRPV::ReturnStatus &_status)
+    {
+        const std::shared_ptr<State> _state = state;
+        std::unique_lock<std::mutex> _lock(_state->mutex);
+        _state->task = _task;
+        _state->pending = true;
+        _state->finished = false;
+        _state->condition.notify_all();
+        if(!_state->condition.wait_for(_lock, std::chrono::nanoseconds(_deadlinens), [&_state]() { return _state->finished; })) {
+            _state->abandoned = true; // executor will exit as soon as Vendor's call will return, if ever
+            _lock.unlock();
+            executor.detach();
+            spawn();
+            return false;
+        }
+        _status = _state->status;
+        return true;
+    }
+
+    void spawn()
+    {
+        state = std::make_shared<State>();
+        executor = std::thread(&CallWatchdog::run, state);
+    }
+
+    static void run(std::shared_ptr<State> _state)
+    {
+        applyVendorThreadsLimit();
+        std::unique_lock<std::mutex> _lock(_state->mutex);
+        for(;;) {
+            _state->condition.wait(_lock, [&_state]() { return _state->pending || _state->stop; });
+            if(_state->stop)
+                return;
+            std::function<IRPV::ReturnStatus()> _task = std::move(_state->task);
+            _state->pending = false;
+            _lock.unlock();
+            const IRPV::ReturnStatus _status = guardedCall(_task);
+            _lock.lock();
+            if(_state->abandoned)
+                return;
+            _state->status = _status;
+            _state->finished = true;
+            _state->condition.notify_all();
+        }
+    }
+
+    std::shared_ptr<IRPV::VerifInterface> recognizer;
+    std::shared_ptr<State>                state;
+    std::thread                           executor;
+};
+
+//---------------------------------------------------
+
+struct MatchCounters
+{
+    MatchCounters() : matchtime(0), threadcputime(0), errors(0), timeouts(0), skipped(0) {}
+
+    double matchtime;     // ns, sum over all calls
+    double threadcputime; // ns, CPU time of the matching workers, calls made through watchdog are not counted
+    size_t errors, timeouts, skipped;
+    std::vector<size_t> slotpairs; // pairs matched by the workers of each WorkerPlacement cpu set
+};
+
+//---------------------------------------------------
+
+struct MatchChunk
+{
+    // Results of the pairs matched by one worker between two merges, so hot loop does not synchronize per call
+    MatchChunk() : cpustart(0), cputime(0), matchtime(0), errors(0), timeouts(0), skipped(0) {}
+
+    void start()
+    {
+        cpustart = threadCPUns();
+        cputime = 0;
+        matchtime = 0;
+        errors = timeouts = skipped = 0;
+        calltimes.clear();
+        violations.clear();
+    }
+
+    // Should be called before the lock for merge is taken, so waiting for the lock is not counted
+    void stop()
+    {
+        cputime = threadCPUns() - cpustart;
+    }
+
+    qint64               cpustart, cputime;
+    double               matchtime;
+    size_t               errors, timeouts, skipped;
+    std::vector<double>  calltimes;
+    std::vector<uint8_t> violations;
+};
+
+//---------------------------------------------------
+
+void matchOne(IRPV::VerifInterface &_recognizer, CallWatchdog *_watchdog, qint64 _deadlinens,
+              const BiometricTemplate &_vtemplate, const BiometricTemplate &_etemplate, double &_similarity,
+              ProgressReporter &_progress, MatchChunk &_chunk, bool _verbose, std::mutex &_printmutex)
+{
+    if(_etemplate.timedout || _vtemplate.timedout) {
+        _similarity = -1.0; // as the API demands for the result of failed template generation
+        _progress.itemDone(false);
+        _chunk.skipped++;
+        return;
+    }
+    IRPV::ReturnStatus _status;
+    bool _timedout = false;
+    QElapsedTimer _timer;
+    _timer.start();
+    if(_watchdog) {
+        _timedout = !_watchdog->matchTemplates(_vtemplate.data,_etemplate.data,_similarity,_status,_deadlinens);
+        if(_timedout) {
+            _similarity = -1.0;
+            _status = IRPV::ReturnStatus(IRPV::ReturnCode::VendorError,"Timeout, call has been abandoned");
+        }
+    } else {
+        _status = guardedCall([&]() { return _recognizer.matchTemplates(*_vtemplate.data,*_etemplate.data,_similarity); });
+    }
+    const qint64 _calltime = _timer.nsecsElapsed();
+    _chunk.matchtime += _calltime;
+    _chunk.calltimes.push_back(_calltime);
+    _chunk.violations.push_back(_timedout ? 1 : 0);
+    _progress.itemDone(_status.code != IRPV::ReturnCode::Success);
+    if(_timedout) {
+        _chunk.timeouts++;
+    } else if(_status.code != IRPV::ReturnCode::Success) {
+        _chunk.errors++;
+        if(_verbose) {
+            std::lock_guard<std::mutex> _lock(_printmutex);
+            std::cout << "   " << _status.code << std::endl;
+            std::cout << "   " << _status.info << std::endl;
+        }
+    }
+}
+
+//---------------------------------------------------
+
+void mergeChunk(const MatchChunk &_chunk, size_t _pairs, size_t _slot, LatencyProfile &_latency, MatchCounters &_counters)
+{
+    // Should be called under the lock which guards _latency and _counters, _pairs includes skipped ones
+    for(size_t i = 0; i < _chunk.calltimes.size(); ++i)
+        _latency.add(_chunk.calltimes[i], _chunk.violations[i] != 0);
+    _counters.matchtime += _chunk.matchtime;
+    _counters.threadcputime += _chunk.cputime;
+    _counters.errors += _chunk.errors;
+    _counters.timeouts += _chunk.timeouts;
+    _counters.skipped += _chunk.skipped;
+    _counters.slotpairs[_slot] += _pairs - _chunk.skipped;
+}
+
+//---------------------------------------------------
+
+class MatchPipeline
+{
+public:
+    // Each verification template pushed is matched against all enrollment templates by the pool of _workers,
+    // scores of the row are stored at [row*etemplates.size(), (row+1)*etemplates.size()) and template is released
+    MatchPipeline(const std::shared_ptr<IRPV::VerifInterface> &_recognizer, const std::vector<BiometricTemplate> &_etemplates,
+                  std::vector<double> &_similarities, std::vector<uint8_t> &_issameperson,
+                  LatencyProfile &_latency, ProgressReporter &_progress, size_t _workers, double _deadlinems, bool _verbose,
+                  const WorkerPlacement &_placement=WorkerPlacement()) :
+        recognizer(_recognizer),
+        etemplates(_etemplates),
+        similarities(_similarities),
+        issameperson(_issameperson),
+        latency(_latency),
+        progress(_progress),
+        deadlinens(static_cast<qint64>(1e6 * _deadlinems)),
+        verbose(_verbose),
+        queuedepth(2 * std::max<size_t>(1,_workers)),
+        placement(_placement),
+        nodetemplates(_etemplates, _placement),
+        finished(false)
+    {
+        counters.slotpairs.resize(std::max<size_t>(1, placement.cpus.size()), 0);
+        for(size_t i = 0; i < std::max<size_t>(1,_workers); ++i)
+            workers.push_back(std::thread(&MatchPipeline::run, this, i));
+    }
+
+    ~MatchPipeline()
+    {
+        finish();
+    }
+
+    // Blocks while all workers are busy and the queue is full
+    void push(size_t _row, BiometricTemplate &&_vtemplate)
+    {
+        std::unique_lock<std::mutex> _lock(mutex);
+        spacecondition.wait(_lock, [this]() { return queue.size() < queuedepth; });
+        queue.push_back(std::make_pair(_row, std::move(_vtemplate)));
+        _lock.unlock();
+        rowcondition.notify_one();
+    }
+
+    // Waits until all rows pushed have been matched
+    void finish()
+    {
+        {
+            std::lock_guard<std::mutex> _lock(mutex);
+            finished = true;
+        }
+        rowcondition.notify_all();
+        for(size_t i = 0; i < workers.size(); ++i)
+            if(workers[i].joinable())
+                workers[i].join();
+    }
+
+    MatchCounters counters; // valid after finish()
+
+private:
+    void run(size_t _worker)
+    {
+        placement.pin(_worker);
+        applyVendorThreadsLimit();
+        const std::vector<BiometricTemplate> &_etemplates = nodetemplates.local(placement.slot(_worker));
+        const std::shared_ptr<IRPV::VerifInterface> _recognizer = placement.recognizer(_worker, recognizer);
+        std::unique_ptr<CallWatchdog> _watchdog(deadlinens > 0 ? new CallWatchdog(_recognizer) : nullptr);
+        MatchChunk _chunk;
+        for(;;) {
+            std::pair<size_t,BiometricTemplate> _item;
+            {
+                std::unique_lock<std::mutex> _lock(mutex);
+                rowcondition.wait(_lock, [this]() { return finished || !queue.empty(); });
+                if(queue.empty())
+                    return;
+                _item.first = queue.front().first;
+                _item.second = std::move(queue.front().second);
+                queue.pop_front();
+            }
+            spacecondition.notify_one();
+
+            const BiometricTemplate &_vtemplate = _item.second;
+            const size_t _offset = _item.first * _etemplates.size();
+            _chunk.start();
+            for(size_t i = 0; i < _etemplates.size(); ++i) {
+                if(_etemplates[i].label == _vtemplate.label)
+                    issameperson[_offset + i] = 1;
+                matchOne(*_recognizer, _watchdog.get(), deadlinens, _vtemplate, _etemplates[i], similarities[_offset + i],
+                         progress, _chunk, verbose, mutex);
+            }
+
+            _chunk.stop();
+            // Row results are merged under lock, so hot loop above does not synchronize per call
+            std::lock_guard<std::mutex> _lock(mutex);
+            if(verbose)
+                std::cout << "  Matched for label: " << _vtemplate.label << std::endl;
+            mergeChunk(_chunk, _etemplates.size(), placement.slot(_worker), latency, counters);
+        }
+    }
+
+    std::shared_ptr<IRPV::VerifInterface>           recognizer;
+    const std::vector<BiometricTemplate>            &etemplates;
+    std::vector<double>                             &similarities;
+    std::vector<uint8_t>                            &issameperson;
+    LatencyProfile                                  &latency;
+    ProgressReporter                                &progress;
+    qint64                                          deadlinens;
+    bool                                            verbose;
+    size_t                                          queuedepth;
+    WorkerPlacement                                 placement;
+    NodeTemplates                                   nodetemplates;
+    bool                                            finished;
+    std::deque<std::pair<size_t,BiometricTemplate>> queue;
+    std::mutex                                      mutex;
+    std::condition_variable                         rowcondition, spacecondition;
+    std::vector<std::thread>                        workers;
+};
+
+//---------------------------------------------------
+
+struct TemplatePair
+{
+    TemplatePair() {}
+
+    TemplatePair(size_t _enrollment, size_t _verification, uint8_t _same) :
+        enrollment(_enrollment),
+        verification(_verification),
+        same(_same) {}
+
+    bool operator<(const TemplatePair &other) const
+    {
+        // Enrollment-major order keeps enrollment template hot in cache while its pairs are matched
+        return (enrollment < other.enrollment) || ((enrollment == other.enrollment) && (verification < other.verification));
+    }
+
+    size_t  enrollment;   // index of enrollment template
+    size_t  verification; // index of verification template
+    uint8_t same;         // 1 - same, 0 - not the same
+};
+
+//---------------------------------------------------
+
+bool readPairList(const QString &_filename, const QDir &_basedir, QStringList &_enrollfiles, QStringList &_verifyfiles,
+                  std::vector<TemplatePair> &_pairs, QString &_error)
+{
+    // Each line: image A, image B and same/different flag separated by tabs (or spaces if there are no tabs)
+    // Relative paths are resolved against _basedir, images referenced several times get the only template
+    QFile _file(_filename);
+    if(!_file.open(QFile::ReadOnly | QFile::Text)) {
+        _error = QString("Can not open pair list %1").arg(_filename);
+        return false;
+    }
+    QHash<QString,size_t> _enrollindex, _verifyindex;
+    int _line = 0;
+    while(!_file.atEnd()) {
+        const QString _text = QString::fromUtf8(_file.readLine()).trimmed();
+        _line++;
+        if(_text.isEmpty() || _text.startsWith("#"))
+            continue;
+        QStringList _fields = _text.contains('\t') ? _text.split('\t') : _text.simplified().split(' ');
+        if(_fields.size() != 3) {
+            _error = QString("Pair list line %1 should have 3 fields").arg(_line);
+            return false;
+        }
+        const QString _flag = _fields.at(2).trimmed().toLower();
+        uint8_t _same;
+        if((_flag == "1") || (_flag == "same") || (_flag == "true"))
+            _same = 1;
+        else if((_flag == "0") || (_flag == "different") || (_flag == "false"))
+            _same = 0;
+        else {
+            _error = QString("Pair list line %1 has invalid same/different flag").arg(_line);
+            return false;
+        }
+        const QString _enrollfile = QDir::cleanPath(_basedir.absoluteFilePath(_fields.at(0).trimmed()));
+        const QString _verifyfile = QDir::cleanPath(_basedir.absoluteFilePath(_fields.at(1).trimmed()));
+        if(!_enrollindex.contains(_enrollfile)) {
+            _enrollindex.insert(_enrollfile, static_cast<size_t>(_enrollfiles.size()));
+            _enrollfiles.append(_enrollfile);
+        }
+        if(!_verifyindex.contains(_verifyfile)) {
+            _verifyindex.insert(_verifyfile, static_cast<size_t>(_verifyfiles.size()));
+            _verifyfiles.append(_verifyfile);
+        }
+        _pairs.push_back(TemplatePair(_enrollindex.value(_enrollfile), _verifyindex.value(_verifyfile), _same));
+    }
+    std::sort(_pairs.begin(), _pairs.end());
+    return true;
+}
+
+//---------------------------------------------------
+
+MatchCounters matchPairs(const std::shared_ptr<IRPV::VerifInterface> &_recognizer, const std::vector<BiometricTemplate> &_etemplates,
+                         const std::vector<BiometricTemplate> &_vtemplates, const std::vector<TemplatePair> &_pairs,
+                         std::vector<double> &_similarities, LatencyProfile &_latency, ProgressReporter &_progress,
+                         size_t _workers, double _deadlinems, bool _verbose, const WorkerPlacement &_placement=WorkerPlacement(),
+                         NodeTemplates *_nodetemplates=nullptr)
+{
+    // Pairs are split into chunks which are taken by workers in order, so each worker walks pairs of the same
+    // enrollment template sequentially and results of the chunk are merged under lock once per chunk.
+    // Caller could pass _nodetemplates to reuse enrollment templates replicas between calls
+    std::unique_ptr<NodeTemplates> _ownnodetemplates(_nodetemplates ? nullptr : new NodeTemplates(_etemplates, _placement));
+    NodeTemplates &_replicas = _nodetemplates ? *_nodetemplates : *_ownnodetemplates;
+    const size_t _chunk = 256;
+    const qint64 _deadlinens = static_cast<qint64>(1e6 * _deadlinems);
+    std::atomic<size_t> _nextchunk(0);
+    std::mutex _mutex;
+    MatchCounters _counters;
+    _counters.slotpairs.resize(std::max<size_t>(1, _placement.cpus.size()), 0);
+    auto _run = [&](size_t _worker) {
+        _placement.pin(_worker);
+        applyVendorThreadsLimit();
+        const std::vector<BiometricTemplate> &_localetemplates = _replicas.local(_placement.slot(_worker));
+        const std::shared_ptr<IRPV::VerifInterface> _localrecognizer = _placement.recognizer(_worker, _recognizer);
+        std::unique_ptr<CallWatchdog> _watchdog(_deadlinens > 0 ? new CallWatchdog(_localrecognizer) : nullptr);
+        MatchChunk _local;
+        for(;;) {
+            const size_t _begin = _chunk * _nextchunk.fetch_add(1);
+            if(_begin >= _pairs.size())
+                return;
+            const size_t _end = std::min(_pairs.size(), _begin + _chunk);
+            _local.start();
+            for(size_t k = _begin; k < _end; ++k)
+                matchOne(*_localrecognizer, _watchdog.get(), _deadlinens, _vtemplates[_pairs[k].verification], _localetemplates[_pairs[k].enrollment],
+                         _similarities[k], _progress, _local, _verbose, _mutex);
+            _local.stop();
+            std::lock_guard<std::mutex> _lock(_mutex);
+            mergeChunk(_local, _end - _begin, _placement.slot(_worker), _latency, _counters);
+        }
+    };
+    std::vector<std::thread> _threads;
+    for(size_t i = 0; i < std::max<size_t>(1,_workers); ++i)
+        _threads.push_back(std::thread(_run, i));
+    for(size_t i = 0; i < _threads.size(); ++i)
+        _threads[i].join();
+    return _counters;
+}
+
+//--------------------------------------------------
+
+struct CoreSplit
+{
+    CoreSplit(size_t _workers, int _vendorthreads) :
+        workers(_workers),
+        vendorthreads(_vendorthreads),
+        pairspersecond(0),
+        cores(0) {}
+
+    size_t workers;        // matching workers of the harness
+    int    vendorthreads;  // threads limit of Vendor's API per worker
+    double pairspersecond;
+    double cores;          // effective cores used, process CPU time divided by wall time
+};
+
+//--------------------------------------------------
+
+std::vector<CoreSplit> tuneCoreSplit(const std::shared_ptr<IRPV::VerifInterface> &_recognizer, const std::vector<BiometricTemplate> &_etemplates,
+                                     const std::vector<BiometricTemplate> &_vtemplates, const std::vector<TemplatePair> &_trialpairs,
+                                     size_t _cores, size_t _maxworkers, double _deadlinems, const WorkerPlacement &_placement=WorkerPlacement())
+{
+    // Each split of _cores between matching workers and Vendor's threads matches the same trial pairs,
+    // so the caller could select the split with the best total throughput. Number of workers never exceeds
+    // _maxworkers, because concurrent calls are allowed only if user has confirmed that Vendor's API is thread safe.
+    // For each number of workers Vendor's threads limits 1, 2, 4 ... up to the cores per worker are tried,
+    // so with the single worker Vendor's threads are still tuned
+    std::vector<CoreSplit> _splits;
+    const size_t _limit = std::max<size_t>(1, std::min(_cores, _maxworkers));
+    for(size_t _workers = 1; ; _workers = std::min(2 * _workers, _limit)) {
+        const size_t _perworker = std::max<size_t>(1, _cores / _workers);
+        for(size_t _threads = 1; _threads < _perworker; _threads *= 2)
+            _splits.push_back(CoreSplit(_workers, static_cast<int>(_threads)));
+        _splits.push_back(CoreSplit(_workers, static_cast<int>(_perworker)));
+        if(_workers == _limit)
+            break;
+    }
+    std::vector<double> _similarities(_trialpairs.size(), 0);
+    NodeTemplates _nodetemplates(_etemplates, _placement); // replicas are shared by all splits, so copying is not measured
+    QElapsedTimer _timer;
+    for(size_t i = 0; i < _splits.size(); ++i) {
+        vendorThreadsLimit() = _splits[i].vendorthreads;
+        LatencyProfile _latency;
+        ProgressReporter _progress("Trial", _trialpairs.size(), "pairs", 0);
+        if(i == 0) // warm-up pass with a worker per node, so the first split is not penalized by cold caches and replicas are ready
+            matchPairs(_recognizer, _etemplates, _vtemplates, _trialpairs, _similarities, _latency, _progress,
+                       std::min(_limit, std::max<size_t>(1, _placement.cpus.size())), _deadlinems, false, _placement, &_nodetemplates);
+        const qint64 _cpustart = processCPUns();
+        _timer.start();
+        const MatchCounters _counters = matchPairs(_recognizer, _etemplates, _vtemplates, _trialpairs, _similarities, _latency, _progress,
+                                                   _splits[i].workers, _deadlinems, false, _placement, &_nodetemplates);
+        const qint64 _walltime = std::max<qint64>(1, _timer.nsecsElapsed());
+        _splits[i].pairspersecond = 1e9 * (_trialpairs.size() - _counters.skipped) / _walltime;
+        _splits[i].cores = static_cast<double>(processCPUns() - _cpustart) / _walltime;
+    }
+    return _splits;
+}
+
+//--------------------------------------------------
+
+qint64 peakRSSkb()
+{
+    // Peak resident set size of the process in kilobytes, 0 if not available on the platform
+#ifdef Q_OS_LINUX
+    struct rusage _usage;
+    if(getrusage(RUSAGE_SELF, &_usage) == 0)
+        return static_cast<qint64>(_usage.ru_maxrss);
+#endif
+    return 0;
+}
+
 //--------------------------------------------------
 void showTimeConsumption(qint64 secondstotal)
 {
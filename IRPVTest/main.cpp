@@ -1,7 +1,8 @@
 
 #include <iostream>
 
-#include "irpvhelper.h"
+#include "irpvcompare.h"
+#include "irpvdaemon.h"
 
 int main(int argc, char *argv[])
 {
@@ -14,10 +15,30 @@ int main(int argc, char *argv[])
     size_t vtpp = 1, etpp = 1, rocpoints = 10000;
     bool verbose = false, rewriteoutput = false, shuffletemplates = false;
     uint confexamples = 3;
+    size_t warmupcalls = 0, firstkcalls = 10, seriespoints = 100;
+    QString cpulist;
+    int numanode = -1;
+    uint progressperiod = 10;
+    size_t loaderthreads = 2, loaderqueuedepth = 16, readaheadfiles = 32;
+    double gendeadlinems = 0, matchdeadlinems = 0, genslams = 0, matchslaus = 0;
+    size_t matchworkers = 1;
+    int vendorthreads = 0;
+    size_t autosplitpairs = 0;
+    bool pipelined = false;
+    bool nodeinstances = false;
+    bool logroc = false;
+    QString farlist;
+    QString pairlistfile;
     QString apiresourcespath;
     QImage::Format qimgtargetformat = QImage::Format_RGB888;
-    // If no args passed, show help
-    if(argc == 1) {
+    // Compare mode does not run evaluation, it checks reports for regressions
+    if((argc > 1) && (QString(argv[1]) == "compare"))
+        return compareReports(argc - 2, argv + 2);
+    // Daemon mode keeps Vendor's API initialized and serves evaluation jobs over Unix domain socket
+    if((argc > 1) && (QString(argv[1]) == "daemon"))
+        return runDaemon(argc - 2, argv + 2);
+    // If no args passed or help is requested, show help
+    if((argc == 1) || (QString(argv[1]) == "-h")) {
         std::cout << APP_NAME << " version " << APP_VERSION << std::endl;
         std::cout << "Options:" << std::endl
                   << "\t-g - force to open all images in 8-bit grayscale mode, if not set all images will be opened in 24-bit rgb color mode" << std::endl
@@ -27,10 +48,37 @@ int main(int argc, char *argv[])
                   << "\t-v[int] - set how namy verification templates per person should be created (default: " << vtpp << ")" << std::endl
                   << "\t-e[int] - set how namy enrollment templates per person should be created (default: " << etpp << ")" << std::endl
                   << "\t-p[int] - set how many points for ROC curve should be computed (default: " << rocpoints << ")" << std::endl
+                  << "\t-L - place ROC points on impostor scores quantiles spaced logarithmically in FAR instead of evenly spaced similarity thresholds" << std::endl
+                  << "\t-F[str] - comma separated FAR values to report FRR at, for the instance: -F1e-3,1e-4 (default: decades down to 1/negative pairs)" << std::endl
                   << "\t-f[int] - number of exmples to count result confident (default: " << confexamples << ")" << std::endl
+                  << "\t-u[int] - number of warm-up calls per role excluded from steady-state latency (default: " << warmupcalls << ")" << std::endl
+                  << "\t-k[int] - number of first calls per role which latency should be reported separately (default: " << firstkcalls << ")" << std::endl
+                  << "\t-t[int] - number of points in latency time series per role (default: " << seriespoints << ")" << std::endl
+                  << "\t-a[str] - pin harness threads to the cpus listed, for the instance: -a0-7,16-23 (default: no pinning)" << std::endl
+                  << "\t-n[int] - pin harness threads to the cpus of selected NUMA node (default: no pinning)" << std::endl
+                  << "\t-l[int] - progress report period in seconds, 0 to disable (default: " << progressperiod << ")" << std::endl
+                  << "\t-d[int] - number of images loader threads (default: " << loaderthreads << ")" << std::endl
+                  << "\t-q[int] - depth of decoded images queue (default: " << loaderqueuedepth << ")" << std::endl
+                  << "\t-A[int] - number of files to read ahead of the images loader (default: " << readaheadfiles << ")" << std::endl
+                  << "\t-T[real] - createTemplate deadline in ms, timed out calls are abandoned (default: no deadline)" << std::endl
+                  << "\t-M[real] - matchTemplates deadline in ms, timed out calls are abandoned (default: no deadline)" << std::endl
+                  << "\t          abandoned call keeps running inside Vendor's API concurrently with the next calls, so -T and -M demand reentrant Vendor's API" << std::endl
+                  << "\t-G[real] - createTemplate SLA threshold in ms (default: createTemplate deadline)" << std::endl
+                  << "\t-K[real] - matchTemplates SLA threshold in us (default: matchTemplates deadline)" << std::endl
+                  << "\t-j[int] - number of matching worker threads, Vendor's API should be thread safe if greater than 1 (default: " << matchworkers << ")" << std::endl
+                  << "\t-z[int] - limit of Vendor's API internal threads (OpenMP, MKL, OpenBLAS) per harness thread (default: no limit)" << std::endl
+                  << "\t-y[int] - auto split cores between up to -j matching workers and Vendor's API threads, trial size in pairs per split (default: 0 - disabled)" << std::endl
+                  << "\t-N - separate Vendor's API instance for the matching workers of each NUMA node, Vendor's model memory is multiplied by nodes" << std::endl
+                  << "\t-c - pipelined mode, verification templates are matched as soon as they are created, Vendor's API should be thread safe" << std::endl
+                  << "\t-x[str] - pair list file, only listed pairs will be matched. Each line: image A, image B and 1/0 (same/different) flag" << std::endl
+                  << "\t          separated by tabs or spaces, relative paths are resolved against input directory" << std::endl
                   << "\t-b - be more verbose (print all measurements)" << std::endl
                   << "\t-s - shuffle templates before matching" << std::endl
-                  << "\t-w - force output file to be rewritten if already existed" << std::endl;
+                  << "\t-w - force output file to be rewritten if already existed" << std::endl
+                  << "Compare mode:" << std::endl
+                  << "\t" << APP_NAME << " compare [options] baseline.json candidate.json - check candidate reports for regressions, run without options for help" << std::endl
+                  << "Daemon mode:" << std::endl
+                  << "\t" << APP_NAME << " daemon [options] - serve evaluation jobs over Unix domain socket, run with -h for help" << std::endl;
         return 0;
     }
     // Let's parse user's command input
@@ -57,9 +105,72 @@ int main(int argc, char *argv[])
             case 'p':
                     rocpoints = QString(++(*argv)).toUInt();
                 break;
+            case 'L':
+                    logroc = true;
+                break;
+            case 'F':
+                    farlist = QString(++(*argv));
+                break;
             case 'f':
                 confexamples = QString(++(*argv)).toUInt();
                 break;
+            case 'u':
+                    warmupcalls = QString(++(*argv)).toUInt();
+                break;
+            case 'k':
+                    firstkcalls = QString(++(*argv)).toUInt();
+                break;
+            case 't':
+                    seriespoints = QString(++(*argv)).toUInt();
+                break;
+            case 'a':
+                    cpulist = QString(++(*argv));
+                break;
+            case 'n':
+                    numanode = QString(++(*argv)).toInt();
+                break;
+            case 'l':
+                    progressperiod = QString(++(*argv)).toUInt();
+                break;
+            case 'd':
+                    loaderthreads = QString(++(*argv)).toUInt();
+                break;
+            case 'q':
+                    loaderqueuedepth = QString(++(*argv)).toUInt();
+                break;
+            case 'A':
+                    readaheadfiles = QString(++(*argv)).toUInt();
+                break;
+            case 'T':
+                    gendeadlinems = QString(++(*argv)).toDouble();
+                break;
+            case 'M':
+                    matchdeadlinems = QString(++(*argv)).toDouble();
+                break;
+            case 'G':
+                    genslams = QString(++(*argv)).toDouble();
+                break;
+            case 'K':
+                    matchslaus = QString(++(*argv)).toDouble();
+                break;
+            case 'j':
+                    matchworkers = QString(++(*argv)).toUInt();
+                break;
+            case 'z':
+                    vendorthreads = QString(++(*argv)).toInt();
+                break;
+            case 'y':
+                    autosplitpairs = QString(++(*argv)).toUInt();
+                break;
+            case 'c':
+                    pipelined = true;
+                break;
+            case 'N':
+                    nodeinstances = true;
+                break;
+            case 'x':
+                    pairlistfile = QString(++(*argv));
+                break;
             case 'b':
                     verbose = true;
                 break;
@@ -95,35 +206,137 @@ int main(int argc, char *argv[])
         std::cerr << "Number of confexamples should be greater than zero! Abort...";
         return 5;
     }
+    // Let's check FAR values to report FRR at
+    std::vector<double> targetFARs;
+    const QStringList farvalues = farlist.split(',');
+    for(int i = 0; i < farvalues.size(); ++i) {
+        if(farvalues.at(i).trimmed().isEmpty())
+            continue;
+        bool _ok = false;
+        const double _far = farvalues.at(i).trimmed().toDouble(&_ok);
+        if(!_ok || (_far <= 0) || (_far > 1)) {
+            std::cerr << "Invalid FAR value '" << farvalues.at(i).toStdString() << "', it should be a number in (0, 1]! Abort...";
+            return 5;
+        }
+        targetFARs.push_back(_far);
+    }
+    // SLA thresholds are equal to deadlines if not set explicitly
+    if(genslams <= 0)
+        genslams = gendeadlinems;
+    if(matchslaus <= 0)
+        matchslaus = 1e3 * matchdeadlinems;
     // Ok we can go forward
     std::cout << "Input dir:\t" << indir.absolutePath().toStdString() << std::endl;
     std::cout << "Output dir:\t" << outdir.absolutePath().toStdString() << std::endl;    
     // Let's also check if structure of the input directory is irpv-valid
     QDateTime startdt(QDateTime::currentDateTime());
-    std::cout << std::endl << "Stage 1 - input directory parsing" << std::endl;
-    QStringList subdirs = indir.entryList(QDir::Dirs | QDir::NoDotAndDotDot, QDir::NoSort);
-    std::cout << "  Total subdirs: " << subdirs.size() << std::endl;
-    size_t validsubdirs = 0;
-    QStringList filefilters;
-    filefilters << "*.jpg" << "*.jpeg" << "*.gif" << "*.png" << ".bmp";
+    QStringList subdirs, distractorfiles;
+    size_t validsubdirs = 0, distractors = 0;
+    const QStringList filefilters = imageFileFilters();
     const size_t minfilespp = (vtpp == 0 ? etpp : etpp + vtpp);
-    for(int i = 0; i < subdirs.size(); ++i) {
-        QStringList _files = QDir(indir.absolutePath().append("/%1").arg(subdirs.at(i))).entryList(filefilters,QDir::Files | QDir::NoDotAndDotDot);
-        if(static_cast<uint>(_files.size()) >= minfilespp) {
-            validsubdirs++;           
+    // In pair list mode templates are created only for the images referenced
+    QStringList pairenrollfiles, pairverifyfiles;
+    std::vector<TemplatePair> templatepairs;
+    if(pairlistfile.isEmpty()) {
+        std::cout << std::endl << "Stage 1 - input directory parsing" << std::endl;
+        subdirs = indir.entryList(QDir::Dirs | QDir::NoDotAndDotDot, QDir::Name); // sorted, so labels do not depend on the file system
+        std::cout << "  Total subdirs: " << subdirs.size() << std::endl;
+        for(int i = 0; i < subdirs.size(); ++i) {
+            QStringList _files = QDir(indir.absolutePath().append("/%1").arg(subdirs.at(i))).entryList(filefilters,QDir::Files | QDir::NoDotAndDotDot);
+            if(static_cast<uint>(_files.size()) >= minfilespp) {
+                validsubdirs++;
+            }
+        }
+        std::cout << "  Valid subdirs: " << validsubdirs << std::endl;
+        if(validsubdirs*etpp == 0) {
+            std::cerr << std::endl << "There is 0 enrollment templates! Test could not be performed! Abort..." << std::endl;
+            return 5;
+        }
+        distractorfiles = indir.entryList(filefilters,QDir::Files | QDir::NoDotAndDotDot, QDir::Name);
+        distractors = static_cast<size_t>(distractorfiles.size());
+        std::cout << "  Distractor files: " << distractors << std::endl;
+        if((validsubdirs*vtpp + distractors) == 0) {
+            std::cerr << std::endl << "There is 0 verification templates! Test could not be performed! Abort..." << std::endl;
+            return 6;
+        }
+    } else {
+        std::cout << std::endl << "Stage 1 - pair list parsing" << std::endl;
+        QString _error;
+        if(!readPairList(pairlistfile, indir, pairenrollfiles, pairverifyfiles, templatepairs, _error)) {
+            std::cerr << _error << "! Abort...";
+            return 11;
+        }
+        std::cout << "  Pairs: " << templatepairs.size() << std::endl;
+        std::cout << "  Unique enrollment images: " << pairenrollfiles.size() << std::endl;
+        std::cout << "  Unique verification images: " << pairverifyfiles.size() << std::endl;
+        if(templatepairs.empty()) {
+            std::cerr << std::endl << "There is 0 pairs! Test could not be performed! Abort..." << std::endl;
+            return 11;
+        }
+        size_t _positive = 0;
+        for(size_t k = 0; k < templatepairs.size(); ++k)
+            _positive += templatepairs[k].same;
+        std::cout << "  Positive pairs: " << _positive << std::endl;
+        std::cout << "  Negative pairs: " << templatepairs.size() - _positive << std::endl;
+        // ROC could be computed only if there are more positive and negative pairs than confexamples
+        if((_positive <= confexamples) || (templatepairs.size() - _positive <= confexamples)) {
+            std::cerr << std::endl << "Pair list should have more than " << confexamples << " positive and negative pairs! Test could not be performed! Abort..." << std::endl;
+            return 11;
+        }
+        if(pipelined || shuffletemplates) {
+            std::cout << "  Pipelined mode and shuffling are not applicable to pair list, so they will not be used" << std::endl;
+            pipelined = false;
+            shuffletemplates = false;
         }
     }
-    std::cout << "  Valid subdirs: " << validsubdirs << std::endl;
-    if(validsubdirs*etpp == 0) {
-        std::cerr << std::endl << "There is 0 enrollment templates! Test could not be performed! Abort..." << std::endl;
-        return 5;
+
+    // Harness threads placement should be done before Vendor's API initialization,
+    // so Vendor's model and all our buffers will be allocated on the local NUMA node
+    const std::vector<std::vector<int>> numatopology = readNUMATopology();
+    std::vector<int> pinnedcpus;
+    if(!cpulist.isEmpty()) {
+        pinnedcpus = parseCPUList(cpulist);
+        if(pinnedcpus.empty()) {
+            std::cerr << "Invalid cpu list! Abort...";
+            return 10;
+        }
+    } else if(numanode >= 0) {
+        if(numanode >= static_cast<int>(numatopology.size())) {
+            std::cerr << "NUMA node you've provided does not exists! Abort...";
+            return 10;
+        }
+        pinnedcpus = numatopology[static_cast<size_t>(numanode)];
+    }
+    std::vector<int> activenodes; // NUMA nodes where harness threads are allowed to run
+    for(size_t i = 0; i < pinnedcpus.size(); ++i) {
+        const int _node = findNUMANode(numatopology, pinnedcpus[i]);
+        if(std::find(activenodes.begin(), activenodes.end(), _node) == activenodes.end())
+            activenodes.push_back(_node);
     }
-    QStringList distractorfiles = indir.entryList(filefilters,QDir::Files | QDir::NoDotAndDotDot);
-    const size_t distractors = static_cast<size_t>(distractorfiles.size());
-    std::cout << "  Distractor files: " << distractors << std::endl;
-    if((validsubdirs*vtpp + distractors) == 0) {
-        std::cerr << std::endl << "There is 0 verification templates! Test could not be performed! Abort..." << std::endl;
-        return 6;
+    if(pinnedcpus.empty()) {
+        for(size_t i = 0; i < numatopology.size(); ++i)
+            activenodes.push_back(static_cast<int>(i));
+    }
+    if(!pinnedcpus.empty()) {
+        std::cout << std::endl << "Pinning harness threads to " << pinnedcpus.size() << " cpus: ";
+        if(!pinCurrentThread(pinnedcpus)) {
+            std::cerr << "Can not set threads affinity! Abort...";
+            return 10;
+        }
+        std::cout << "Success" << std::endl;
+    }
+    // Matching workers are pinned round-robin over the active NUMA nodes
+    WorkerPlacement workerplacement = makeWorkerPlacement(numatopology, pinnedcpus);
+    if(workerplacement.cpus.size() > 1)
+        std::cout << std::endl << "Matching workers will be spread over " << workerplacement.cpus.size() << " NUMA nodes with a replica of enrollment templates on each" << std::endl;
+    const size_t availablecores = pinnedcpus.empty() ? std::max(1u, std::thread::hardware_concurrency()) : pinnedcpus.size();
+    // Vendor's threading runtimes read their limits on initialization, so limit should be set before.
+    // Main thread calls Vendor's API too, so it is limited until ROC computation where harness threads are restored
+    const int harnessthreads = harnessThreads();
+    if(vendorthreads > 0) {
+        std::cout << std::endl << "Vendor's API threads limit: " << vendorthreads << std::endl;
+        setVendorThreadsLimit(vendorthreads);
+        applyVendorThreadsLimit();
     }
 
     QElapsedTimer elapsedtimer;
@@ -141,6 +354,37 @@ int main(int argc, char *argv[])
         std::cout << "Can not initialize Vendor's API! Abort..." << std::endl;
         return 7;
     }
+    // Vendor's API could ask to decode and downscale images before they will be passed to createTemplate
+    IRPV::ImageSpec imagespec;
+    status = getPreferredImageSpec(recognizer, imagespec);
+    if(status.code != IRPV::ReturnCode::Success) {
+        std::cout << "  Can not get preferred image spec: " << status.code << ", no preferences will be used" << std::endl;
+        imagespec = IRPV::ImageSpec();
+    }
+    if(imagespec.depth == 8)
+        qimgtargetformat = QImage::Format_Grayscale8;
+    else if(imagespec.depth == 24)
+        qimgtargetformat = QImage::Format_RGB888;
+    std::cout << "  Preferred max size: "
+              << (imagespec.maxwidth > 0 ? QString::number(imagespec.maxwidth) : QString("any")) << "x"
+              << (imagespec.maxheight > 0 ? QString::number(imagespec.maxheight) : QString("any")) << std::endl;
+    std::cout << "  Images format: " << qimgtargetformat << std::endl;
+    // Optional Vendor's API instance per NUMA node, so matching workers do not read the model from remote memory
+    if(nodeinstances && (workerplacement.cpus.size() > 1)) {
+        std::cout << "  Initializing instances for " << workerplacement.cpus.size() << " NUMA nodes: ";
+        elapsedtimer.start();
+        status = initializeNodeRecognizers(workerplacement, apiresourcespath.toStdString());
+        std::cout << status.code << std::endl;
+        std::cout << "  Time: " << elapsedtimer.elapsed() << " ms" << std::endl;
+        if(status.code != IRPV::ReturnCode::Success) {
+            std::cout << "Vendor's error description: " << status.info << std::endl;
+            std::cout << "Can not initialize Vendor's API! Abort..." << std::endl;
+            return 7;
+        }
+    } else if(nodeinstances) {
+        std::cout << "  Matching workers run on a single NUMA node, so the only instance will be used" << std::endl;
+        nodeinstances = false;
+    }
 
     // We need also check if output file does not exist
     QFile outputfile(outdir.absolutePath().append("/%1.json").arg(VENDOR_API_NAME));
@@ -153,171 +397,361 @@ int main(int argc, char *argv[])
     }
 
     // Seems that all requirements are matched to test, let's start files processing
-    std::cout << std::endl << "Stage 3 - templates generation" << std::endl;
+    if(pipelined)
+        std::cout << std::endl << "Stage 3 and 4 - pipelined templates generation and match" << std::endl;
+    else
+        std::cout << std::endl << "Stage 3 - templates generation" << std::endl;
 
+    const size_t etcount = templatepairs.empty() ? validsubdirs*etpp : static_cast<size_t>(pairenrollfiles.size());               // total enrollment templates
+    const size_t vtcount = templatepairs.empty() ? validsubdirs*vtpp + distractors : static_cast<size_t>(pairverifyfiles.size()); // total verification templates
+
+    // Images referenced several times get the only template, but each template owns its own buffer:
+    // Vendor's API takes std::vector, so templates packed into one arena would be copied on every call
     std::vector<BiometricTemplate> etemplates; // here we will store enrollment templates
-    etemplates.resize(validsubdirs*etpp);
+    etemplates.resize(etcount);
     size_t   etpos = 0;     // position in etemplates
+    size_t   etsizebytes = 0;
     double etgentime = 0; // enrollment template gen time holder
     size_t   eterrors = 0;  // enrollment template gen errors
-
-    std::vector<BiometricTemplate> vtemplates; // here we will store verification templates
-    vtemplates.resize(validsubdirs*vtpp + distractors);
+    double etloadtime = 0; // enrollment images decoding and preprocessing time holder
+    size_t   ettimeouts = 0; // enrollment template gen calls abandoned by watchdog
+    double etthreadcpu = 0; // CPU time of the harness thread in createTemplate, Vendor's internal threads are not counted
+    double etprocesscpu = 0; // CPU time of the whole process in createTemplate except images loader threads, so it shows Vendor's threads
+    LatencyProfile etlatency(warmupcalls,firstkcalls,etcount,seriespoints,1e6*genslams);
+
+    std::vector<BiometricTemplate> vtemplates; // here we will store verification templates, in pipelined mode they are not stored
+    if(!pipelined)
+        vtemplates.resize(vtcount);
     size_t   vtpos = 0;     // position in vtemplates
+    size_t   vtsizebytes = 0;
     double vtgentime = 0; // verification templates gen time holder
     size_t   vterrors = 0;  // verification template gen errors
+    double vtloadtime = 0; // verification images decoding and preprocessing time holder
+    size_t   vttimeouts = 0; // verification template gen calls abandoned by watchdog
+    double vtthreadcpu = 0, vtprocesscpu = 0;
+    LatencyProfile vtlatency(warmupcalls,firstkcalls,vtcount,seriespoints,1e6*genslams);
 
+    // Matching results, scores of each verification template are stored in a row of etcount length
+    size_t comparisions = etcount*vtcount;
+    size_t totalpositivepairs = etpp*vtpp*validsubdirs;
+    size_t totalnegativepairs = etpp*vtpp*validsubdirs*(validsubdirs-1) + etpp*validsubdirs*distractors;
+    if(!templatepairs.empty()) {
+        comparisions = templatepairs.size();
+        totalpositivepairs = 0;
+        for(size_t k = 0; k < templatepairs.size(); ++k)
+            totalpositivepairs += templatepairs[k].same;
+        totalnegativepairs = comparisions - totalpositivepairs;
+    }
+    std::vector<double>  similarities(comparisions,0); // here we will store similarity
+    std::vector<uint8_t> issameperson(comparisions,0); // 1 - same, 0 - not the same, init by 0 because the number of true negative pairs is greater than true positive
+    LatencyProfile mtlatency(warmupcalls,firstkcalls,comparisions,seriespoints,1e3*matchslaus);
+    std::unique_ptr<ProgressReporter> matchprogress;
+    std::unique_ptr<MatchPipeline> matchpipeline;
+    QElapsedTimer matchwalltimer; // matching workers run in parallel, so throughput is computed from wall time
+    qint64 matchcpustart = 0;
+    // Matching starts when all enrollment templates are ready
+    auto startmatching = [&]() {
+        // Optional shuffle enrollment templates to prevent attacks on system
+        if(shuffletemplates) {
+            std::srand ( unsigned ( std::time(0) ) );
+            std::cout << std::endl << "Shuffling templates" << std::endl;
+            std::random_shuffle(etemplates.begin(),etemplates.end());
+        }
+        matchwalltimer.start();
+        matchcpustart = processCPUns();
+        matchprogress.reset(new ProgressReporter("Pairs", comparisions, "pairs", progressperiod));
+        matchpipeline.reset(new MatchPipeline(recognizer,etemplates,similarities,issameperson,mtlatency,*matchprogress,
+                                              matchworkers,matchdeadlinems,verbose,workerplacement));
+    };
+
+    // Stage 3 order of the images: enrollment and verification files for each person and then distractors
+    std::vector<ImageJob> imagejobs;
+    imagejobs.reserve(etcount + vtcount);
     size_t label = 0;
-
-    IRPV::Image irpvimg;
     for(int i = 0; i < subdirs.size(); ++i) {
         QDir _subdir(indir.absolutePath().append("/%1").arg(subdirs.at(i)));
         QStringList _files = _subdir.entryList(filefilters,QDir::Files | QDir::NoDotAndDotDot, QDir::Name);
         if(static_cast<size_t>(_files.size()) >= minfilespp) {
-
-            std::cout << std::endl << "  Label: " << label << " - " << subdirs.at(i) << std::endl;
-
-            for(size_t j = 0; j < etpp; ++j) {
-                if(verbose)
-                    std::cout << "   - enrollment template: " << _files.at(j) << std::endl;
-                std::vector<uint8_t> _templ;
-                irpvimg = readimage(_subdir.absoluteFilePath(_files.at(j)),qimgtargetformat,verbose);
-                elapsedtimer.start();
-                status = recognizer->createTemplate(irpvimg,IRPV::TemplateRole::Enrollment_11,_templ);
-                etgentime += elapsedtimer.nsecsElapsed();
-                etemplates[etpos++] = BiometricTemplate(label,IRPV::TemplateRole::Enrollment_11,std::move(_templ));
-                if(status.code != IRPV::ReturnCode::Success) {
-                    eterrors++;
-                    if(verbose) {
-                        std::cout << "   " << status.code << std::endl;
-                        std::cout << "   " << status.info << std::endl;
-                    }
-                }
-            }
-
-            for(size_t j = etpp; j < minfilespp; j++) {
-                if(verbose)
-                    std::cout << "   - verification template: " << _files.at(j) << std::endl;
-                std::vector<uint8_t> _templ;
-                irpvimg = readimage(_subdir.absoluteFilePath(_files.at(j)),qimgtargetformat,verbose);
-                elapsedtimer.start();                
-                status = recognizer->createTemplate(irpvimg,IRPV::TemplateRole::Verification_11,_templ);
-                vtgentime += elapsedtimer.nsecsElapsed();
-                vtemplates[vtpos++] = BiometricTemplate(label,IRPV::TemplateRole::Verification_11,std::move(_templ));
-                if(status.code != IRPV::ReturnCode::Success) {
-                    vterrors++;
-                    if(verbose) {
-                        std::cout << "   " << status.code << std::endl;
-                        std::cout << "   " << status.info << std::endl;
-                    }
-                }
-            }
-
+            for(size_t j = 0; j < minfilespp; ++j)
+                imagejobs.push_back(ImageJob(_subdir.absoluteFilePath(_files.at(static_cast<int>(j))),label,
+                                             j < etpp ? IRPV::TemplateRole::Enrollment_11 : IRPV::TemplateRole::Verification_11,
+                                             subdirs.at(i)));
             label++; // increment for the next person / subdir
         }
     }
     // Also we need to enroll all distractors
     for(int i = 0; i < distractorfiles.size(); ++i) {
-        std::cout << std::endl << "  Label(D): " << label << " - " << distractorfiles.at(i) << std::endl;
+        imagejobs.push_back(ImageJob(indir.absoluteFilePath(distractorfiles.at(i)),label,IRPV::TemplateRole::Verification_11,distractorfiles.at(i)));
+        label++; // increment for the next distractor
+    }
+    // Pair list images, template index in etemplates/vtemplates is equal to the index in the file list
+    for(int i = 0; i < pairenrollfiles.size(); ++i)
+        imagejobs.push_back(ImageJob(pairenrollfiles.at(i),static_cast<size_t>(i),IRPV::TemplateRole::Enrollment_11,QFileInfo(pairenrollfiles.at(i)).fileName()));
+    for(int i = 0; i < pairverifyfiles.size(); ++i)
+        imagejobs.push_back(ImageJob(pairverifyfiles.at(i),static_cast<size_t>(i),IRPV::TemplateRole::Verification_11,QFileInfo(pairverifyfiles.at(i)).fileName()));
+    if(pipelined) // all enrollment templates should be created before the first verification one
+        std::stable_partition(imagejobs.begin(), imagejobs.end(), [](const ImageJob &_job) { return _job.role == IRPV::TemplateRole::Enrollment_11; });
+    std::vector<QString> imagefiles(imagejobs.size());
+    for(size_t k = 0; k < imagejobs.size(); ++k)
+        imagefiles[k] = imagejobs[k].filename;
+
+    qint64 calltime = 0; // single call time holder
+    qint64 waittime = 0; // time spent by the harness in waiting for the next decoded image
+    double etwaittime = 0, vtwaittime = 0;
+
+    IRPV::Image irpvimg;
+    bool timedout = false;
+    std::unique_ptr<CallWatchdog> genwatchdog(gendeadlinems > 0 ? new CallWatchdog(recognizer) : nullptr);
+    ImageLoader imageloader(imagefiles,qimgtargetformat,imagespec.maxwidth,imagespec.maxheight,loaderthreads,loaderqueuedepth,readaheadfiles);
+    ProgressReporter genprogress("Templates", etcount + vtcount, "templates", progressperiod);
+    for(size_t k = 0; k < imagejobs.size(); ++k) {
+        const ImageJob &_job = imagejobs[k];
+        const bool _enrollment = (_job.role == IRPV::TemplateRole::Enrollment_11);
+        if(verbose) {
+            if((k == 0) || (imagejobs[k-1].label != _job.label))
+                std::cout << std::endl << "  Label" << (k >= imagejobs.size() - distractors ? "(D)" : "") << ": "
+                          << _job.label << " - " << _job.labelname << std::endl;
+            std::cout << "   - " << (_enrollment ? "enrollment" : "verification") << " template: " << _job.filename << std::endl;
+        }
         std::vector<uint8_t> _templ;
-        irpvimg = readimage(indir.absoluteFilePath(distractorfiles.at(i)),qimgtargetformat,verbose);
         elapsedtimer.start();
-        status = recognizer->createTemplate(irpvimg,IRPV::TemplateRole::Verification_11,_templ);
-        vtgentime += elapsedtimer.nsecsElapsed();
-        vtemplates[vtpos++] = BiometricTemplate(label,IRPV::TemplateRole::Verification_11,std::move(_templ));
-        if(status.code != IRPV::ReturnCode::Success) {
-            vterrors++;
+        irpvimg = imageloader.next();
+        waittime = elapsedtimer.nsecsElapsed();
+        if(verbose)
+            std::cout << "   Size: " << irpvimg.width << "x" << irpvimg.height << " Depth: " << static_cast<int>(irpvimg.depth) << " bits" << std::endl;
+        // With watchdog Vendor's call is made by the executor thread, so only process CPU time is meaningful
+        const qint64 _threadcpu = threadCPUns(), _processcpu = processCPUns(), _loadercpu = imageloader.cpuns();
+        elapsedtimer.start();
+        if(genwatchdog) {
+            timedout = !genwatchdog->createTemplate(irpvimg,_job.role,_templ,status,static_cast<qint64>(1e6*gendeadlinems));
+            if(timedout) { // such template will be handled as the result of failed template generation
+                _templ.clear();
+                status = IRPV::ReturnStatus(IRPV::ReturnCode::TemplateCreationError,"Timeout, call has been abandoned");
+            }
+        } else {
+            status = recognizer->createTemplate(irpvimg,_job.role,_templ);
+        }
+        calltime = elapsedtimer.nsecsElapsed();
+        const qint64 _threadcputime = threadCPUns() - _threadcpu, _processcputime = processCPUns() - _processcpu - (imageloader.cpuns() - _loadercpu);
+        if(_enrollment) {
+            etgentime += calltime;
+            etthreadcpu += _threadcputime;
+            etprocesscpu += _processcputime;
+            etwaittime += waittime;
+            etloadtime += imageloader.readtime[k] + imageloader.decodetime[k];
+            etlatency.add(calltime,timedout);
+            if(etpos == 0)
+                etsizebytes = _templ.size();
+            etemplates[etpos++] = BiometricTemplate(_job.label,_job.role,std::move(_templ),timedout);
+        } else {
+            vtgentime += calltime;
+            vtthreadcpu += _threadcputime;
+            vtprocesscpu += _processcputime;
+            vtwaittime += waittime;
+            vtloadtime += imageloader.readtime[k] + imageloader.decodetime[k];
+            vtlatency.add(calltime,timedout);
+            if(vtpos == 0)
+                vtsizebytes = _templ.size();
+            if(pipelined) {
+                if(!matchpipeline)
+                    startmatching();
+                matchpipeline->push(vtpos++,BiometricTemplate(_job.label,_job.role,std::move(_templ),timedout));
+            } else {
+                vtemplates[vtpos++] = BiometricTemplate(_job.label,_job.role,std::move(_templ),timedout);
+            }
+        }
+        genprogress.itemDone(status.code != IRPV::ReturnCode::Success);
+        if(timedout) {
+            if(_enrollment)
+                ettimeouts++;
+            else
+                vttimeouts++;
+            if(verbose)
+                std::cout << "   " << status.info << std::endl;
+        } else if(status.code != IRPV::ReturnCode::Success) {
+            if(_enrollment)
+                eterrors++;
+            else
+                vterrors++;
             if(verbose) {
                 std::cout << "   " << status.code << std::endl;
                 std::cout << "   " << status.info << std::endl;
             }
         }
-        label++; // increment for the next distractor
+    }
+    genprogress.stop();
+    double loaderreadtime = 0, loaderdecodetime = 0;
+    for(size_t k = 0; k < imagejobs.size(); ++k) {
+        loaderreadtime += imageloader.readtime[k];
+        loaderdecodetime += imageloader.decodetime[k];
     }
 
-    etgentime /= etemplates.size();
-    vtgentime /= vtemplates.size();
+    const double gentemplatespersecond = 1e9 * (etcount + vtcount) / std::max(1.0, etgentime + vtgentime);
+    const double etcores = etprocesscpu / std::max(1.0, etgentime); // effective cores used per call
+    const double vtcores = vtprocesscpu / std::max(1.0, vtgentime);
+    etthreadcpu /= etcount;
+    etprocesscpu /= etcount;
+    vtthreadcpu /= vtcount;
+    vtprocesscpu /= vtcount;
+    etgentime /= etcount;
+    vtgentime /= vtcount;
+    etloadtime /= etcount;
+    vtloadtime /= vtcount;
+    etwaittime /= etcount;
+    vtwaittime /= vtcount;
+    etlatency.finish();
+    vtlatency.finish();
 
     std::cout << "\nEnrollment templates" << std::endl
-              << "  Total: " << etemplates.size() << std::endl
+              << "  Total: " << etcount << std::endl
               << "  Errors:  " << eterrors << std::endl
+              << "  Timeouts:  " << ettimeouts << std::endl
               << "  Avgtime: " << 1e-6 * etgentime << " ms" << std::endl
+              << "  First call: " << (etlatency.firstcalls.empty() ? 0 : 1e-6 * etlatency.firstcalls[0]) << " ms" << std::endl
+              << "  Steady-state avgtime: " << 1e-6 * etlatency.steadymean() << " ms" << std::endl
+              << "  CPU time (thread / process): " << (genwatchdog ? QString("n/a") : QString::number(1e-6 * etthreadcpu)) << " / " << 1e-6 * etprocesscpu << " ms, cores used: " << etcores << std::endl
+              << "  Image load avgtime: " << 1e-6 * etloadtime << " ms" << std::endl
+              << "  Image wait avgtime: " << 1e-6 * etwaittime << " ms" << std::endl
               << "\nVerification templates" << std::endl
-              << "  Total: " << vtemplates.size() << std::endl
+              << "  Total: " << vtcount << std::endl
               << "  Errors:  " << vterrors << std::endl
-              << "  Avgtime: " << 1e-6 * vtgentime << " ms" << std::endl;
-
-    // Optional shuffle enrollment templates to prevent attacks on system
-    if(shuffletemplates) {
-        std::srand ( unsigned ( std::time(0) ) );
-        std::cout << std::endl << "Shuffling templates" << std::endl;
-        std::random_shuffle(etemplates.begin(),etemplates.end());
+              << "  Timeouts:  " << vttimeouts << std::endl
+              << "  Avgtime: " << 1e-6 * vtgentime << " ms" << std::endl
+              << "  First call: " << (vtlatency.firstcalls.empty() ? 0 : 1e-6 * vtlatency.firstcalls[0]) << " ms" << std::endl
+              << "  Steady-state avgtime: " << 1e-6 * vtlatency.steadymean() << " ms" << std::endl
+              << "  CPU time (thread / process): " << (genwatchdog ? QString("n/a") : QString::number(1e-6 * vtthreadcpu)) << " / "
+              << (pipelined ? QString("n/a") : QString::number(1e-6 * vtprocesscpu)) << " ms, cores used: " << (pipelined ? QString("n/a") : QString::number(vtcores)) << std::endl
+              << "  Image load avgtime: " << 1e-6 * vtloadtime << " ms" << std::endl
+              << "  Image wait avgtime: " << 1e-6 * vtwaittime << " ms" << std::endl
+              << "\nImages loader" << std::endl
+              << "  Threads: " << loaderthreads << std::endl
+              << "  Read avgtime: " << 1e-6 * loaderreadtime / imagejobs.size() << " ms" << std::endl
+              << "  Decode avgtime: " << 1e-6 * loaderdecodetime / imagejobs.size() << " ms" << std::endl;
+
+    // Optional search of the best split of cores between matching workers and Vendor's threads
+    std::vector<CoreSplit> coresplits;
+    if((autosplitpairs > 0) && pipelined) {
+        std::cout << std::endl << "Cores split could not be tuned in pipelined mode, so it will not be used" << std::endl;
+    } else if((autosplitpairs > 0) && (availablecores < 2)) {
+        std::cout << std::endl << "Cores split could not be tuned on a single core, so it will not be used" << std::endl;
+    } else if(autosplitpairs > 0) {
+        std::cout << std::endl << "Cores split tuning on " << availablecores << " cores with up to " << matchworkers << " workers" << std::endl;
+        if(matchworkers == 1)
+            std::cout << "  Vendor's API is not declared thread safe by -j, so only Vendor's threads could be tuned" << std::endl;
+        std::vector<TemplatePair> _trialpairs;
+        for(size_t k = 0; k < std::min(autosplitpairs, comparisions); ++k)
+            _trialpairs.push_back(templatepairs.empty() ? TemplatePair(k % etcount, (k / etcount) % vtcount, 0) : templatepairs[k]);
+        coresplits = tuneCoreSplit(recognizer,etemplates,vtemplates,_trialpairs,availablecores,matchworkers,matchdeadlinems,workerplacement);
+        size_t _best = 0;
+        for(size_t i = 0; i < coresplits.size(); ++i) {
+            std::cout << "  Workers: " << coresplits[i].workers << ", Vendor's threads: " << coresplits[i].vendorthreads
+                      << " - " << coresplits[i].pairspersecond << " pairs/s, cores used: " << coresplits[i].cores << std::endl;
+            if(coresplits[i].pairspersecond > coresplits[_best].pairspersecond)
+                _best = i;
+        }
+        matchworkers = coresplits[_best].workers;
+        vendorthreads = coresplits[_best].vendorthreads;
+        setVendorThreadsLimit(vendorthreads);
+        std::cout << "  Selected: " << matchworkers << " workers with " << vendorthreads << " Vendor's threads each" << std::endl;
     }
 
-    // Ok, templates are ready, so we can start to match them
-    std::cout << std::endl << "Stage 4 - templates match" << std::endl;
-
-    size_t comparisions = etemplates.size()*vtemplates.size();
-    size_t totalpositivepairs = etpp*vtpp*validsubdirs;
-    size_t totalnegativepairs = etpp*vtpp*validsubdirs*(validsubdirs-1) + etpp*validsubdirs*distractors;
-    std::vector<double>  similarities(comparisions,0); // here we will store similarity
-    std::vector<uint8_t> issameperson(comparisions,0); // 1 - same, 0 - not the same, init by 0 because the number of true negative pairs is greater than true positive
-    double matchtime = 0;
-
-    size_t mterrors = 0;
-
-    size_t matchcounter = 0;
-    for(size_t i = 0; i < etemplates.size(); ++i) {
-        std::cout << "  Matching for label: " << etemplates[i].label << std::endl;
-        for(size_t j = 0; j < vtemplates.size(); ++j) {
-            elapsedtimer.start();
-            status = recognizer->matchTemplates(vtemplates[j].data,etemplates[i].data,similarities[matchcounter]);
-            matchtime += elapsedtimer.nsecsElapsed();
-            if(etemplates[i].label == vtemplates[j].label) {
-                issameperson[matchcounter] = 1;
-            }
-            if(status.code != IRPV::ReturnCode::Success) {
-                mterrors++;
-                if(verbose) {
-                    std::cout << "   " << status.code << std::endl;
-                    std::cout << "   " << status.info << std::endl;
-                }
-            }
-            matchcounter++;
+    MatchCounters mtcounters;
+    qint64 matchwalltime = 0;
+    if(!templatepairs.empty()) {
+        // Ok, templates are ready, so we can start to match listed pairs
+        std::cout << std::endl << "Stage 4 - listed pairs match" << std::endl;
+        for(size_t k = 0; k < templatepairs.size(); ++k)
+            issameperson[k] = templatepairs[k].same;
+        matchwalltimer.start();
+        matchcpustart = processCPUns();
+        ProgressReporter _pairsprogress("Pairs", comparisions, "pairs", progressperiod);
+        mtcounters = matchPairs(recognizer,etemplates,vtemplates,templatepairs,similarities,mtlatency,_pairsprogress,
+                                matchworkers,matchdeadlinems,verbose,workerplacement);
+        matchwalltime = matchwalltimer.nsecsElapsed();
+    } else {
+        if(!pipelined) {
+            // Ok, templates are ready, so we can start to match them
+            std::cout << std::endl << "Stage 4 - templates match" << std::endl;
+            startmatching();
+            for(size_t j = 0; j < vtemplates.size(); ++j)
+                matchpipeline->push(j,std::move(vtemplates[j]));
         }
+        matchpipeline->finish();
+        matchwalltime = matchwalltimer.nsecsElapsed();
+        matchprogress->stop();
+        mtcounters = matchpipeline->counters;
+        matchpipeline.reset();
     }
+    double matchtime = mtcounters.matchtime;
+    // In pipelined mode process CPU time includes templates generation running at the same time, so it is not reported
+    const double matchcores = static_cast<double>(processCPUns() - matchcpustart) / std::max<qint64>(1, matchwalltime);
+    const double matchthreadcpu = mtcounters.threadcputime / std::max<size_t>(1, comparisions - mtcounters.skipped);
+    const size_t mterrors = mtcounters.errors;
+    const size_t mttimeouts = mtcounters.timeouts; // matchTemplates calls abandoned by watchdog
+    const size_t mtskipped = mtcounters.skipped;   // pairs with template which generation has been abandoned, Vendor's API is not called for them
+    vtemplates.clear(); vtemplates.shrink_to_fit();
 
     std::cout << std::endl << "  Total comparisions: " << comparisions << std::endl;
     std::cout << "  Positive pairs: " << totalpositivepairs << std::endl;
     std::cout << "  Negative pairs: " << totalnegativepairs << std::endl;
     std::cout << "  Errors: " << mterrors << std::endl;
-    matchtime /= comparisions;
+    std::cout << "  Timeouts: " << mttimeouts << std::endl;
+    std::cout << "  Skipped (no template): " << mtskipped << std::endl;
+    const double matchpairspersecond = 1e9 * (comparisions - mtskipped) / std::max<qint64>(1, matchwalltime);
+    matchtime /= std::max<size_t>(1, comparisions - mtskipped);
+    mtlatency.finish();
     std::cout << std::endl << "Avg match time: " << matchtime*1e-3 << " us" << std::endl;
+    std::cout << "First match time: " << (mtlatency.firstcalls.empty() ? 0 : 1e-3 * mtlatency.firstcalls[0]) << " us" << std::endl;
+    std::cout << "Steady-state avg match time: " << mtlatency.steadymean()*1e-3 << " us" << std::endl;
+    std::cout << "Workers CPU time per pair: " << (matchdeadlinems > 0 ? QString("n/a") : QString::number(matchthreadcpu*1e-3))
+              << " us, cores used: " << (pipelined ? QString("n/a") : QString::number(matchcores)) << std::endl;
 
 
     // Ok, now we can compute ROC table
     std::cout << std::endl << "Stage 5 - ROC computation" << std::endl;
+    restoreHarnessThreads(harnessthreads); // Vendor's threads limit should not apply to harness own parallel loops
 
     // But first let's release unused memory
-    size_t etsizebytes = etemplates[0].data.size();
     etemplates.clear(); etemplates.shrink_to_fit();
-    size_t vtsizebytes = vtemplates[0].data.size();
-    vtemplates.clear(); vtemplates.shrink_to_fit();
 
-    std::vector<ROCPoint> vROC = computeROC(rocpoints, issameperson, totalpositivepairs, totalnegativepairs, similarities, confexamples);
+    // Genuine scores are moved to the front of similarities, after that labels are not needed anymore
+    const size_t genuinescores = partitionScores(similarities, issameperson);
+    issameperson.clear(); issameperson.shrink_to_fit();
+    // Sorted in place genuine and impostor scores let us answer operating point queries in O(log n) without copies
+    const ScoreDistribution scores(similarities, genuinescores);
+    std::vector<ROCPoint> vROC = logroc ? computeLogROC(rocpoints, scores, confexamples)
+                                        : computeROC(rocpoints, scores, confexamples);
 
     double rocarea = findArea(vROC);
     std::cout << "  Area under the ROC curve: " << QString::number(rocarea,'f',validdigits(rocpoints,confexamples)) << std::endl;
     // First let's estimate the best FAR value we can select
     double bestFAR = std::exp(std::log(10.0) * -validdigits(totalnegativepairs,confexamples));
-    // Ok now we can find FRR for selected FAR from the ROC curve
-    double bestFRR = findFRR(vROC, bestFAR);
+    // Ok now we can find FRR for selected FAR, it is interpolated from the scores, so it does not depend on ROC points
+    const double minFRR = static_cast<double>(confexamples) / totalpositivepairs;
+    double bestFRR = std::max(minFRR, scores.frrAtFAR(bestFAR));
     std::cout << "  Best FRR (FAR): "
               << QString::number(bestFRR,'f',validdigits(totalpositivepairs))
               << " ("
               << QString::number(bestFAR,'f',validdigits(totalnegativepairs))
               << ")" << std::endl;
+    if(targetFARs.empty()) {
+        for(double _far = 0.1; _far * totalnegativepairs >= 1.0; _far *= 0.1)
+            targetFARs.push_back(_far);
+    }
+    QJsonArray frrjsarr;
+    for(size_t i = 0; i < targetFARs.size(); ++i) {
+        const double _frr = std::max(minFRR, scores.frrAtFAR(targetFARs[i]));
+        std::cout << "  FRR at FAR " << targetFARs[i] << ": " << QString::number(_frr,'f',validdigits(totalpositivepairs)) << std::endl;
+        frrjsarr.push_back(QJsonObject({
+                                           qMakePair(QLatin1String("FAR"),QJsonValue(targetFARs[i])),
+                                           qMakePair(QLatin1String("FRR"),QJsonValue(_frr))
+                                       }));
+    }
+    const double eer = scores.eer();
+    std::cout << "  EER: " << QString::number(eer,'f',validdigits(std::min(totalpositivepairs,totalnegativepairs))) << std::endl;
     QDateTime enddt = QDateTime::currentDateTime();
+    const qint64 peakrsskb = peakRSSkb();
+    std::cout << "  Peak memory: " << peakrsskb / 1024 << " MB" << std::endl;
 
     // Let's print time consumption
     showTimeConsumption(startdt.secsTo(enddt));
@@ -325,28 +759,124 @@ int main(int argc, char *argv[])
     std::cout << " Wait untill output data will be saved..." << std::endl;
 
     QJsonObject etjsobj({
-                            qMakePair(QLatin1String("Templates"),QJsonValue(static_cast<qint64>(etpp*validsubdirs))),
+                            qMakePair(QLatin1String("Templates"),QJsonValue(static_cast<qint64>(etcount))),
                             qMakePair(QLatin1String("Perperson"),QJsonValue(static_cast<int>(etpp))),
                             qMakePair(QLatin1String("Errors"),QJsonValue(static_cast<qint64>(eterrors))),
+                            qMakePair(QLatin1String("Timeouts"),QJsonValue(static_cast<qint64>(ettimeouts))),
                             qMakePair(QLatin1String("Gentime_ms"),QJsonValue(etgentime*1e-6)),
-                            qMakePair(QLatin1String("Size_bytes"),QJsonValue(static_cast<qint64>(etsizebytes)))
+                            qMakePair(QLatin1String("Loadtime_ms"),QJsonValue(etloadtime*1e-6)),
+                            qMakePair(QLatin1String("Waittime_ms"),QJsonValue(etwaittime*1e-6)),
+                            qMakePair(QLatin1String("Processcpu_ms"),QJsonValue(etprocesscpu*1e-6)),
+                            qMakePair(QLatin1String("Cores"),QJsonValue(etcores)),
+                            qMakePair(QLatin1String("Size_bytes"),QJsonValue(static_cast<qint64>(etsizebytes))),
+                            qMakePair(QLatin1String("Latency"),QJsonValue(serializeLatency(etlatency,1e-6,"ms")))
                         });
 
     QJsonObject vtjsobj({
-                            qMakePair(QLatin1String("Templates"),QJsonValue(static_cast<qint64>(vtpp*validsubdirs))),
+                            qMakePair(QLatin1String("Templates"),QJsonValue(static_cast<qint64>(vtcount - distractors))),
                             qMakePair(QLatin1String("Perperson"),QJsonValue(static_cast<int>(vtpp))),
                             qMakePair(QLatin1String("Distractors"),QJsonValue(static_cast<qint64>(distractors))),
                             qMakePair(QLatin1String("Errors"),QJsonValue(static_cast<qint64>(vterrors))),
+                            qMakePair(QLatin1String("Timeouts"),QJsonValue(static_cast<qint64>(vttimeouts))),
                             qMakePair(QLatin1String("Gentime_ms"),QJsonValue(vtgentime*1e-6)),
-                            qMakePair(QLatin1String("Size_bytes"),QJsonValue(static_cast<qint64>(vtsizebytes)))
+                            qMakePair(QLatin1String("Loadtime_ms"),QJsonValue(vtloadtime*1e-6)),
+                            qMakePair(QLatin1String("Waittime_ms"),QJsonValue(vtwaittime*1e-6)),
+                            qMakePair(QLatin1String("Size_bytes"),QJsonValue(static_cast<qint64>(vtsizebytes))),
+                            qMakePair(QLatin1String("Latency"),QJsonValue(serializeLatency(vtlatency,1e-6,"ms")))
                         });
 
     QJsonObject matchjsobj({
                                qMakePair(QLatin1String("Positivepairs"), QJsonValue(static_cast<qint64>(totalpositivepairs))),
                                qMakePair(QLatin1String("Negativepairs"), QJsonValue(static_cast<qint64>(totalnegativepairs))),
                                qMakePair(QLatin1String("Errors"), QJsonValue(static_cast<qint64>(mterrors))),
-                               qMakePair(QLatin1String("Matchtime_us"), QJsonValue(matchtime*1e-3))
+                               qMakePair(QLatin1String("Timeouts"), QJsonValue(static_cast<qint64>(mttimeouts))),
+                               qMakePair(QLatin1String("Skipped"), QJsonValue(static_cast<qint64>(mtskipped))),
+                               qMakePair(QLatin1String("Matchtime_us"), QJsonValue(matchtime*1e-3)),
+                               qMakePair(QLatin1String("Latency"), QJsonValue(serializeLatency(mtlatency,1e-3,"us")))
                            });
+    // With watchdog Vendor's calls are made by the executor threads, so harness thread CPU time says nothing and is not reported
+    if(!genwatchdog) {
+        etjsobj.insert(QLatin1String("Threadcpu_ms"), QJsonValue(etthreadcpu*1e-6));
+        vtjsobj.insert(QLatin1String("Threadcpu_ms"), QJsonValue(vtthreadcpu*1e-6));
+    }
+    if(matchdeadlinems <= 0)
+        matchjsobj.insert(QLatin1String("Threadcpu_us"), QJsonValue(matchthreadcpu*1e-3));
+    // In pipelined mode verification templates are generated while matching workers run, so process CPU time
+    // of both includes the other one. Enrollment templates are generated before matching starts, so they are not affected
+    if(!pipelined) {
+        vtjsobj.insert(QLatin1String("Processcpu_ms"), QJsonValue(vtprocesscpu*1e-6));
+        vtjsobj.insert(QLatin1String("Cores"), QJsonValue(vtcores));
+        matchjsobj.insert(QLatin1String("Cores"), QJsonValue(matchcores));
+    }
+
+    QJsonArray nodesjsarr;
+    for(size_t i = 0; i < numatopology.size(); ++i) {
+        const bool _active = std::find(activenodes.begin(), activenodes.end(), static_cast<int>(i)) != activenodes.end();
+        QJsonObject _nodejsobj({
+                                   qMakePair(QLatin1String("Node"), QJsonValue(static_cast<int>(i))),
+                                   qMakePair(QLatin1String("Cpus"), QJsonValue(serializeCPUList(numatopology[i]))),
+                                   qMakePair(QLatin1String("Active"), QJsonValue(_active))
+                               });
+        if(_active && (activenodes.size() == 1)) // templates are generated by the main thread, so they could be attributed to the node only if it is the only one
+            _nodejsobj.insert(QLatin1String("Templates_per_s"), QJsonValue(gentemplatespersecond));
+        for(size_t s = 0; s < workerplacement.nodes.size(); ++s) {
+            if(workerplacement.nodes[s] != static_cast<int>(i))
+                continue;
+            size_t _workers = 0;
+            for(size_t w = 0; w < matchworkers; ++w)
+                _workers += (workerplacement.slot(w) == s) ? 1 : 0;
+            _nodejsobj.insert(QLatin1String("Matchworkers"), QJsonValue(static_cast<qint64>(_workers)));
+            if(s < mtcounters.slotpairs.size())
+                _nodejsobj.insert(QLatin1String("Pairs_per_s"), QJsonValue(1e9 * mtcounters.slotpairs[s] / std::max<qint64>(1, matchwalltime)));
+        }
+        nodesjsarr.push_back(qMove(_nodejsobj));
+    }
+
+    QJsonObject placementjsobj({
+                                   qMakePair(QLatin1String("Pinned"), QJsonValue(!pinnedcpus.empty())),
+                                   qMakePair(QLatin1String("Cpus"), QJsonValue(serializeCPUList(pinnedcpus))),
+                                   qMakePair(QLatin1String("Nodes"), QJsonValue(nodesjsarr)),
+                                   qMakePair(QLatin1String("Templatereplicas"), QJsonValue(static_cast<int>(workerplacement.cpus.size() > 1 ? workerplacement.cpus.size() : 0))),
+                                   qMakePair(QLatin1String("Vendorinstances"), QJsonValue(static_cast<int>(workerplacement.recognizers.size()))),
+                                   qMakePair(QLatin1String("Templates_per_s"), QJsonValue(gentemplatespersecond)),
+                                   qMakePair(QLatin1String("Pairs_per_s"), QJsonValue(matchpairspersecond))
+                               });
+
+    QJsonObject imagespecjsobj({
+                                   qMakePair(QLatin1String("Maxwidth"), QJsonValue(static_cast<int>(imagespec.maxwidth))),
+                                   qMakePair(QLatin1String("Maxheight"), QJsonValue(static_cast<int>(imagespec.maxheight))),
+                                   qMakePair(QLatin1String("Depth"), QJsonValue(qimgtargetformat == QImage::Format_Grayscale8 ? 8 : 24))
+                               });
+
+    QJsonObject pipelinejsobj({
+                                  qMakePair(QLatin1String("Pipelined"), QJsonValue(pipelined)),
+                                  qMakePair(QLatin1String("Matchworkers"), QJsonValue(static_cast<qint64>(matchworkers))),
+                                  qMakePair(QLatin1String("Vendorthreads"), QJsonValue(vendorthreads)),
+                                  qMakePair(QLatin1String("Availablecores"), QJsonValue(static_cast<qint64>(availablecores)))
+                              });
+    if(!coresplits.empty()) {
+        QJsonArray _splitsjsarr;
+        for(size_t i = 0; i < coresplits.size(); ++i)
+            _splitsjsarr.push_back(QJsonObject({
+                                                   qMakePair(QLatin1String("Workers"), QJsonValue(static_cast<qint64>(coresplits[i].workers))),
+                                                   qMakePair(QLatin1String("Vendorthreads"), QJsonValue(coresplits[i].vendorthreads)),
+                                                   qMakePair(QLatin1String("Pairs_per_s"), QJsonValue(coresplits[i].pairspersecond)),
+                                                   qMakePair(QLatin1String("Cores"), QJsonValue(coresplits[i].cores))
+                                               }));
+        pipelinejsobj.insert(QLatin1String("Coresplits"), QJsonValue(_splitsjsarr));
+    }
+    if(!templatepairs.empty())
+        pipelinejsobj.insert(QLatin1String("Pairlist"), QJsonValue(QFileInfo(pairlistfile).absoluteFilePath()));
+
+    QJsonObject loaderjsobj({
+                                qMakePair(QLatin1String("Threads"), QJsonValue(static_cast<qint64>(loaderthreads))),
+                                qMakePair(QLatin1String("Queuedepth"), QJsonValue(static_cast<qint64>(loaderqueuedepth))),
+                                qMakePair(QLatin1String("Readahead"), QJsonValue(static_cast<qint64>(readaheadfiles))),
+                                qMakePair(QLatin1String("Readtime_ms"), QJsonValue(1e-6 * loaderreadtime / imagejobs.size())),
+                                qMakePair(QLatin1String("Decodetime_ms"), QJsonValue(1e-6 * loaderdecodetime / imagejobs.size())),
+                                qMakePair(QLatin1String("Waittime_ms"), QJsonValue(1e-6 * (etwaittime * etcount + vtwaittime * vtcount) / imagejobs.size())),
+                                qMakePair(QLatin1String("Vendortime_ms"), QJsonValue(1e-6 * (etgentime * etcount + vtgentime * vtcount) / imagejobs.size()))
+                            });
 
     QJsonObject jsonobj({
                             qMakePair(QLatin1String("Name"),QString(VENDOR_API_NAME)),
@@ -359,7 +889,17 @@ int main(int argc, char *argv[])
                             qMakePair(QLatin1String("ROCarea"),QJsonValue(rocarea)),
                             qMakePair(QLatin1String("FAR"),QJsonValue(bestFAR)),
                             qMakePair(QLatin1String("FRR"),QJsonValue(bestFRR)),
-                            qMakePair(QLatin1String("Initms"),inittimems)
+                            qMakePair(QLatin1String("FRRatFAR"),QJsonValue(frrjsarr)),
+                            qMakePair(QLatin1String("EER"),QJsonValue(eer)),
+                            qMakePair(QLatin1String("ROCthresholds"),QJsonValue(QString(logroc ? "Logfar" : "Linear"))),
+                            qMakePair(QLatin1String("Initms"),inittimems),
+                            qMakePair(QLatin1String("Placement"),placementjsobj),
+                            qMakePair(QLatin1String("Imagespec"),imagespecjsobj),
+                            qMakePair(QLatin1String("Loader"),loaderjsobj),
+                            qMakePair(QLatin1String("Pipeline"),pipelinejsobj),
+                            qMakePair(QLatin1String("Memory"),QJsonObject({
+                                                                   qMakePair(QLatin1String("Peakrss_kb"),QJsonValue(peakrsskb))
+                                                               }))
                         });
 
     outputfile.write(QJsonDocument(jsonobj).toJson());
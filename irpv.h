@@ -73,6 +73,39 @@ typedef struct Image {
     size() const { return (width * height * (depth / 8)); }
 } Image;
 
+/** =================================================================
+ * @brief
+ * Struct representing input images preferences of the implementation
+ *
+ * @details
+ * Images which exceed max dimensions are downscaled by IRPVTest with
+ * aspect ratio preserved before they are passed to createTemplate()
+ */
+typedef struct ImageSpec {
+    /** Max number of pixels horizontally, 0 means no limit */
+    uint16_t maxwidth;
+    /** Max number of pixels vertically, 0 means no limit */
+    uint16_t maxheight;
+    /** Preferred number of bits per pixel. Legal values are 0 (no preference), 8 and 24 */
+    uint8_t depth;
+
+    ImageSpec() :
+        maxwidth{0},
+        maxheight{0},
+        depth{0}
+        {}
+
+    ImageSpec(
+        uint16_t maxwidth,
+        uint16_t maxheight,
+        uint8_t depth
+        ) :
+        maxwidth{maxwidth},
+        maxheight{maxheight},
+        depth{depth}
+        {}
+} ImageSpec;
+
 
 /** =================================================================
  * Labels describing the type/role of the template 
@@ -255,6 +288,37 @@ public:
     getImplementation();
 };
 /* End of VerifInterface */
+
+/** =================================================================
+ * @brief
+ * Optional interface to declare input images preferences
+ *
+ * @details
+ * VerifInterface is left unchanged, so libraries built against the previous
+ * version of this header keep working. The implementation which wants to
+ * receive preprocessed images should also sub-class this class, IRPVTest
+ * queries it with dynamic_cast and uses no preferences if the cast fails.
+ */
+class DLLSPEC ImageSpecProvider {
+public:
+    virtual ~ImageSpecProvider() {}
+
+    /**
+     * @brief This function lets the implementation declare the preferred
+     * input images resolution and pixel format. It will be called by the
+     * IRPVTest application after initialize() and before any call to
+     * createTemplate(). Decoding, colour conversion and area-averaged
+     * downscaling are then done by IRPVTest, so the implementation receives
+     * images that do not exceed requested dimensions.
+     * This function will be called N=1 times by the IRPVTest application.
+     *
+     * param[out] spec
+     * Preferred max dimensions and pixel depth
+     */
+    virtual ReturnStatus
+    getPreferredImageSpec(ImageSpec &spec) = 0;
+};
+/* End of ImageSpecProvider */
 }
 
 #endif /* IRPV_H_ */